@@ -0,0 +1,465 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coloring.h"
+#include "kernels.h"
+#include "perturbation.h"
+
+#define DEFAULT_RUNS 10
+#define DEFAULT_TOLERANCE 10.0
+
+typedef struct {
+    const char* name;
+    const char* center_real;    // decimals, parsed with fixed_from_string()
+    const char* center_imag;
+    double width;               // of the view in the complex plane
+} BenchView;
+
+// Changing a view makes its results incomparable with stored baselines, add new ones instead
+static const BenchView corpus[] = {
+    {"home", "-0.5", "0", HOME_WIDTH},
+    {"seahorse", "-0.7453", "0.1127", 0.01},
+    {"interior", "-0.1225", "0.7449", 0.25},    // period 3 bulb, mostly points that never escape
+    {"deep", "0", "1", 1e-26}                   // next to c = i, needs perturbation
+};
+
+#define VIEW_COUNT (int)(sizeof(corpus) / sizeof(corpus[0]))
+#define MAX_RESULTS (VIEW_COUNT * 4)
+
+typedef struct {
+    const char* view;
+    const char* benchmark;
+    Precision precision;
+    int max_iterations;
+    Uint64 pixels;          // per run
+    Uint64 iterations;      // escape counts summed over a run
+    double median_ms;
+    double p99_ms;
+    double baseline_ms;     // median of the baseline run, 0 if it has none
+} BenchResult;
+
+typedef struct {
+    ThreadPool* pool;
+    FrameBuffer* frame;
+    ViewPort view;
+    RenderStrategy strategy;
+    int max_iterations;
+    Precision precision;
+} FrameBench;
+
+typedef struct {
+    PixelGrid grid;
+    int width;
+    int height;
+    int is_julia;
+} PointBench;
+
+typedef struct {
+    ThreadPool* pool;
+    FrameBuffer* frame;
+    int max_iterations;
+} ColorBench;
+
+// One run of a benchmark, returns the escape counts it summed up
+typedef Uint64 (*BenchFunc)(void* context);
+
+// A frame the way the explorer renders one after the view changed, reference orbit included
+static Uint64 run_frame(void* context) {
+    FrameBench* bench = context;
+    FrameBuffer* frame = bench->frame;
+    Complex julia_c = {0.0, 0.0};
+    
+    ReferenceOrbit* reference = NULL;
+    if (bench->precision == PRECISION_PERTURBATION) {
+        reference = create_view_reference(bench->view, 0, julia_c, bench->max_iterations);
+    }
+    PixelGrid grid;
+    if (reference) {
+        grid = make_perturbation_grid(bench->view, frame->width, frame->height, reference);
+    } else {
+        grid = make_pixel_grid(bench->view, frame->width, frame->height, 0, julia_c, bench->max_iterations);
+        grid.precision = bench->precision == PRECISION_PERTURBATION ? PRECISION_DOUBLE_DOUBLE : bench->precision;
+    }
+    render(bench->pool, frame, &grid, bench->strategy);
+    destroy_reference_orbit(reference);
+    
+    Uint64 iterations = 0;
+    for (int i = 0; i < frame->width * frame->height; i++) {
+        iterations += escape_count(frame->iterations[i]);
+    }
+    return iterations;
+}
+
+// Recolors the escape values run_frame() left in the frame, as a palette change does
+static Uint64 run_coloring(void* context) {
+    ColorBench* bench = context;
+    color_frame(bench->pool, bench->frame, bench->max_iterations);
+    return 0;
+}
+
+// mandelbrot() or julia() once per pixel, on the calling thread
+static Uint64 run_points(void* context) {
+    PointBench* bench = context;
+    const PixelGrid* grid = &bench->grid;
+    Uint64 iterations = 0;
+    
+    for (int y = 0; y < bench->height; y++) {
+        for (int x = 0; x < bench->width; x++) {
+            Complex point = {grid->origin.real + x * grid->step_x, grid->origin.imag + y * grid->step_y};
+            if (bench->is_julia) {
+                iterations += escape_count(julia(point, grid->julia_c, grid->max_iterations));
+            } else {
+                iterations += escape_count(mandelbrot(point, grid->max_iterations));
+            }
+        }
+    }
+    return iterations;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// One warm-up run, then runs timed ones for the median and the 99th percentile
+static int measure(BenchFunc func, void* context, int runs, BenchResult* result) {
+    double* times = malloc(runs * sizeof(double));
+    if (!times) {
+        return 0;
+    }
+    
+    result->iterations = func(context);
+    double ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+    for (int i = 0; i < runs; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        func(context);
+        times[i] = (SDL_GetPerformanceCounter() - start) / ticks_per_ms;
+    }
+    
+    qsort(times, runs, sizeof(double), compare_doubles);
+    result->median_ms = runs % 2 ? times[runs / 2] : 0.5 * (times[runs / 2 - 1] + times[runs / 2]);
+    // nearest rank, so with fewer than 100 runs this is the slowest one
+    result->p99_ms = times[(int)ceil(0.99 * runs) - 1];
+    free(times);
+    
+    fprintf(stderr, "%-10s %-10s %10.2f ms median %10.2f ms p99\n",
+            result->view, result->benchmark, result->median_ms, result->p99_ms);
+    return 1;
+}
+
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    
+    char* text = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        rewind(file);
+        text = size >= 0 ? malloc(size + 1) : NULL;
+        if (text) {
+            text[fread(text, 1, size, file)] = '\0';
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+// Median of the result's view and benchmark at the same precision and
+// iteration limit in the JSON written by write_results(), 0 if it is missing
+static double find_baseline(const char* baseline, const BenchResult* result) {
+    char key[192];
+    snprintf(key, sizeof(key), "{\"view\": \"%s\", \"benchmark\": \"%s\", \"precision\": \"%s\", \"max_iterations\": %d,",
+             result->view, result->benchmark, precision_name(result->precision), result->max_iterations);
+    const char* entry = strstr(baseline, key);
+    if (!entry) {
+        return 0.0;
+    }
+    
+    const char* end = strchr(entry, '}');
+    const char* median = strstr(entry, "\"median_ms\": ");
+    if (!median || (end && median > end)) {
+        return 0.0;
+    }
+    return atof(median + strlen("\"median_ms\": "));
+}
+
+// Text of the first "field": value in the baseline, without quotes
+static int find_baseline_field(const char* baseline, const char* field, char* value, size_t size) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": ", field);
+    const char* start = strstr(baseline, key);
+    if (!start) {
+        return 0;
+    }
+    
+    start += strlen(key);
+    if (*start == '"') {
+        start++;
+    }
+    size_t length = strcspn(start, "\",\n");
+    if (length >= size) {
+        return 0;
+    }
+    memcpy(value, start, length);
+    value[length] = '\0';
+    return 1;
+}
+
+static const char* strategy_name(RenderStrategy strategy) {
+    return strategy == RENDER_MARIANI_SILVER ? "mariani-silver" : "brute-force";
+}
+
+// Medians recorded with another kernel, strategy, thread count or frame size
+// say nothing about a regression, so the baseline has to match this run
+static int baseline_matches(const char* baseline, int threads, int width, int height, RenderStrategy strategy) {
+    char kernel[64], recorded_strategy[64], recorded_threads[16], recorded_width[16], recorded_height[16];
+    if (!find_baseline_field(baseline, "kernel", kernel, sizeof(kernel)) ||
+        !find_baseline_field(baseline, "strategy", recorded_strategy, sizeof(recorded_strategy)) ||
+        !find_baseline_field(baseline, "threads", recorded_threads, sizeof(recorded_threads)) ||
+        !find_baseline_field(baseline, "width", recorded_width, sizeof(recorded_width)) ||
+        !find_baseline_field(baseline, "height", recorded_height, sizeof(recorded_height))) {
+        fprintf(stderr, "The baseline does not record the settings it was run with\n");
+        return 0;
+    }
+    
+    int matches = 1;
+    if (strcmp(kernel, get_active_kernel()->name) != 0) {
+        fprintf(stderr, "The baseline used the %s kernel, this run uses %s\n", kernel, get_active_kernel()->name);
+        matches = 0;
+    }
+    if (strcmp(recorded_strategy, strategy_name(strategy)) != 0) {
+        fprintf(stderr, "The baseline rendered %s, this run renders %s\n", recorded_strategy, strategy_name(strategy));
+        matches = 0;
+    }
+    if (atoi(recorded_threads) != threads) {
+        fprintf(stderr, "The baseline used %s threads, this run uses %d\n", recorded_threads, threads);
+        matches = 0;
+    }
+    if (atoi(recorded_width) != width || atoi(recorded_height) != height) {
+        fprintf(stderr, "The baseline rendered %sx%s frames, this run renders %dx%d\n",
+                recorded_width, recorded_height, width, height);
+        matches = 0;
+    }
+    return matches;
+}
+
+static double per_second(Uint64 count, double ms, double unit) {
+    return ms > 0.0 ? count / (ms / 1000.0) / unit : 0.0;
+}
+
+// One result per line, which find_baseline() relies on
+static void write_results(FILE* file, const BenchResult* results, int count, int runs, int threads,
+                          int width, int height, RenderStrategy strategy) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"kernel\": \"%s\",\n", get_active_kernel()->name);
+    fprintf(file, "  \"strategy\": \"%s\",\n", strategy_name(strategy));
+    fprintf(file, "  \"threads\": %d,\n", threads);
+    fprintf(file, "  \"width\": %d,\n", width);
+    fprintf(file, "  \"height\": %d,\n", height);
+    fprintf(file, "  \"runs\": %d,\n", runs);
+    fprintf(file, "  \"results\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchResult* result = &results[i];
+        fprintf(file, "    {\"view\": \"%s\", \"benchmark\": \"%s\", \"precision\": \"%s\", \"max_iterations\": %d, "
+                "\"mpixels_per_s\": %.3f, \"giterations_per_s\": %.4f, \"median_ms\": %.3f, \"p99_ms\": %.3f",
+                result->view, result->benchmark, precision_name(result->precision), result->max_iterations,
+                per_second(result->pixels, result->median_ms, 1e6),
+                per_second(result->iterations, result->median_ms, 1e9),
+                result->median_ms, result->p99_ms);
+        if (result->baseline_ms > 0.0) {
+            fprintf(file, ", \"baseline_median_ms\": %.3f, \"change_percent\": %.1f",
+                    result->baseline_ms, 100.0 * (result->median_ms / result->baseline_ms - 1.0));
+        }
+        fprintf(file, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+// Fills in the baseline medians and returns how many results got slower than tolerance allows
+static int compare_baseline(BenchResult* results, int count, const char* baseline, double tolerance) {
+    int regressions = 0;
+    
+    for (int i = 0; i < count; i++) {
+        BenchResult* result = &results[i];
+        result->baseline_ms = find_baseline(baseline, result);
+        if (result->baseline_ms <= 0.0) {
+            fprintf(stderr, "%-10s %-10s not in the baseline at %s precision and limit %d\n", result->view,
+                    result->benchmark, precision_name(result->precision), result->max_iterations);
+            continue;
+        }
+        
+        double change = 100.0 * (result->median_ms / result->baseline_ms - 1.0);
+        int regressed = change > tolerance;
+        regressions += regressed;
+        fprintf(stderr, "%-10s %-10s %10.2f ms against %10.2f ms %+7.1f%%%s\n", result->view, result->benchmark,
+                result->median_ms, result->baseline_ms, change, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+static int run_corpus(BenchResult* results, ThreadPool* pool, FrameBuffer* frame, int runs,
+                      RenderStrategy strategy, int fixed_limit) {
+    int count = 0;
+    
+    for (int v = 0; v < VIEW_COUNT; v++) {
+        const BenchView* entry = &corpus[v];
+        
+        // square pixels and the zoom the explorer would show, as in headless mode
+        ViewPort view = make_view(0.0, 0.0, entry->width, entry->width * frame->height / frame->width);
+        view.zoom = HOME_WIDTH / entry->width;
+        fixed_from_string(&view.center_real, entry->center_real);
+        fixed_from_string(&view.center_imag, entry->center_imag);
+        int max_iterations = choose_iteration_limit(view, fixed_limit);
+        Precision precision = choose_precision(view, frame->width, frame->height, max_iterations);
+        
+        // the point functions take doubles, which cannot resolve views past double precision
+        if (precision <= PRECISION_DOUBLE) {
+            // the Julia set of the view center, the set the explorer's preview shows there
+            Complex center = {fixed_to_double(&view.center_real), fixed_to_double(&view.center_imag)};
+            PointBench points = {
+                .grid = make_pixel_grid(view, frame->width, frame->height, 0, center, max_iterations),
+                .width = frame->width,
+                .height = frame->height
+            };
+            
+            for (points.is_julia = 0; points.is_julia <= 1; points.is_julia++) {
+                BenchResult* result = &results[count];
+                *result = (BenchResult){
+                    .view = entry->name,
+                    .benchmark = points.is_julia ? "julia" : "mandelbrot",
+                    .precision = PRECISION_DOUBLE,
+                    .max_iterations = max_iterations,
+                    .pixels = (Uint64)frame->width * frame->height
+                };
+                if (!measure(run_points, &points, runs, result)) {
+                    return -1;
+                }
+                count++;
+            }
+        }
+        
+        FrameBench bench = {pool, frame, view, strategy, max_iterations, precision};
+        BenchResult* result = &results[count];
+        *result = (BenchResult){
+            .view = entry->name,
+            .benchmark = "frame",
+            .precision = precision,
+            .max_iterations = max_iterations,
+            .pixels = (Uint64)frame->width * frame->height
+        };
+        if (!measure(run_frame, &bench, runs, result)) {
+            return -1;
+        }
+        count++;
+        
+        ColorBench coloring = {pool, frame, max_iterations};
+        result = &results[count];
+        *result = (BenchResult){
+            .view = entry->name,
+            .benchmark = "color",
+            .precision = precision,
+            .max_iterations = max_iterations,
+            .pixels = (Uint64)frame->width * frame->height
+        };
+        if (!measure(run_coloring, &coloring, runs, result)) {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+int run_bench(int argc, char* argv[], RenderStrategy strategy, int fixed_limit) {
+    int runs = DEFAULT_RUNS;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    int threads = 0;
+    const char* output = "-";
+    const char* baseline_path = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                width = height = 0;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        }
+    }
+    
+    if (runs <= 0) {
+        fprintf(stderr, "--runs expects a positive count\n");
+        return 1;
+    }
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "--size expects WIDTHxHEIGHT in pixels\n");
+        return 1;
+    }
+    char* baseline = NULL;
+    if (baseline_path) {
+        baseline = read_file(baseline_path);
+        if (!baseline) {
+            fprintf(stderr, "Could not read the baseline '%s'\n", baseline_path);
+            return 1;
+        }
+    }
+    
+    ThreadPool* pool = create_thread_pool(threads);
+    FrameBuffer frame;
+    if (!pool || !init_frame_buffer(&frame, NULL, width, height)) {
+        fprintf(stderr, "Benchmark could not be set up\n");
+        free(baseline);
+        if (pool) {
+            destroy_thread_pool(pool);
+        }
+        return 1;
+    }
+    if (baseline && !baseline_matches(baseline, get_thread_pool_size(pool), width, height, strategy)) {
+        fprintf(stderr, "Run with the baseline's settings to compare against it\n");
+        destroy_frame_buffer(&frame);
+        destroy_thread_pool(pool);
+        free(baseline);
+        return 1;
+    }
+    
+    BenchResult results[MAX_RESULTS];
+    int count = run_corpus(results, pool, &frame, runs, strategy, fixed_limit);
+    int status = count < 0 ? 1 : 0;
+    if (count >= 0 && baseline && compare_baseline(results, count, baseline, tolerance) > 0) {
+        fprintf(stderr, "Slower than the baseline by more than %.1f%%\n", tolerance);
+        status = 1;
+    }
+    
+    if (count >= 0) {
+        FILE* file = strcmp(output, "-") == 0 ? stdout : fopen(output, "w");
+        if (file) {
+            write_results(file, results, count, runs, get_thread_pool_size(pool), width, height, strategy);
+            if (file != stdout) {
+                fclose(file);
+            }
+        } else {
+            fprintf(stderr, "Could not open '%s' for writing\n", output);
+            status = 1;
+        }
+    }
+    
+    destroy_frame_buffer(&frame);
+    destroy_thread_pool(pool);
+    free(baseline);
+    return status;
+}
@@ -0,0 +1,19 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "mandelbrot.h"
+
+// Times mandelbrot(), julia() and whole render() frames on a fixed set of
+// views and prints the results as JSON. Options:
+//   --runs N           timed runs of every benchmark, after one warm-up (default 10)
+//   --size WxH         frame size in pixels (default 800x600)
+//   --threads N        render threads, 0 for one per core (default)
+//   --output PATH      file to write the JSON to, "-" for stdout (default)
+//   --baseline PATH    JSON of an earlier run to compare the medians against
+//   --tolerance PCT    how much slower a median may get before it counts as
+//                      a regression (default 10)
+// The kernels must already be initialized. Returns the exit status for main(),
+// which is 1 if a benchmark regressed against the baseline.
+int run_bench(int argc, char* argv[], RenderStrategy strategy, int fixed_limit);
+
+#endif
@@ -0,0 +1,129 @@
+#include "coloring.h"
+#include <math.h>
+#include "kernels.h"
+
+static const Palette palettes[] = {
+    {"classic", 2, {{0, 0, 0, 255}, {51, 102, 255, 255}}},
+    {"fire", 4, {{0, 0, 0, 255}, {128, 16, 0, 255}, {255, 140, 0, 255}, {255, 255, 200, 255}}},
+    {"ocean", 5, {{0, 7, 100, 255}, {32, 107, 203, 255}, {237, 255, 255, 255}, {255, 170, 0, 255},
+                  {0, 2, 0, 255}}},
+    {"gray", 2, {{0, 0, 0, 255}, {255, 255, 255, 255}}},
+};
+
+#define PALETTE_COUNT (int)(sizeof(palettes) / sizeof(palettes[0]))
+
+// the Julia preview's own colors, the color settings leave it alone
+static const Palette preview_palette = {"preview", 2, {{0, 0, 255, 255}, {255, 255, 128, 255}}};
+
+static ColorSettings settings = {0, 0.0, 1.0};
+static Uint32 generation;
+static ColorTable table;
+static ColorTable preview_table;
+
+// Entry i covers the floats whose top bits are i + PHASE_TABLE_BASE and is
+// given the phase of the middle of that range
+static void build_phases(ColorTable* color_table) {
+    for (int i = 0; i < PHASE_TABLE_SIZE; i++) {
+        union {
+            float value;
+            Uint32 bits;
+        } middle = {.bits = (Uint32)(i + PHASE_TABLE_BASE) << (23 - PHASE_MANTISSA_BITS) |
+                            1u << (22 - PHASE_MANTISSA_BITS)};
+        double phase = log(middle.value) * 3.0 / (2.0 * M_PI);
+        phase -= floor(phase);
+        color_table->phases[i] = (Uint32)(phase * COLOR_TABLE_SIZE) & (COLOR_TABLE_SIZE - 1);
+    }
+}
+
+static int scale_channel(double channel, double brightness) {
+    return (int)SDL_min(channel * brightness, 255.0);
+}
+
+// One period of the cosine the palette is walked with
+static void build_colors(ColorTable* color_table, const Palette* palette, double brightness) {
+    for (int i = 0; i < COLOR_TABLE_SIZE; i++) {
+        double position = 0.5 + 0.5 * cos(2.0 * M_PI * i / COLOR_TABLE_SIZE);
+        position *= palette->stop_count - 1;
+        int stop = SDL_min((int)position, palette->stop_count - 2);
+        double blend = position - stop;
+        SDL_Color from = palette->stops[stop];
+        SDL_Color to = palette->stops[stop + 1];
+        
+        color_table->colors[i] = pack_argb(scale_channel(from.r + (to.r - from.r) * blend, brightness),
+                                           scale_channel(from.g + (to.g - from.g) * blend, brightness),
+                                           scale_channel(from.b + (to.b - from.b) * blend, brightness));
+    }
+}
+
+void init_coloring(void) {
+    build_phases(&table);
+    build_colors(&table, &palettes[settings.palette], settings.brightness);
+    build_phases(&preview_table);
+    build_colors(&preview_table, &preview_palette, 1.0);
+}
+
+void set_color_settings(const ColorSettings* new_settings) {
+    ColorSettings previous = settings;
+    settings = *new_settings;
+    settings.palette = SDL_clamp(settings.palette, 0, PALETTE_COUNT - 1);
+    settings.cycle -= floor(settings.cycle);
+    settings.brightness = SDL_max(settings.brightness, 0.0);
+    
+    // cycling, the change made every frame while it is animated, only moves the offset
+    if (settings.palette != previous.palette || settings.brightness != previous.brightness) {
+        build_colors(&table, &palettes[settings.palette], settings.brightness);
+    }
+    table.offset = (Uint32)(settings.cycle * COLOR_TABLE_SIZE);
+    generation++;
+}
+
+ColorSettings get_color_settings(void) {
+    return settings;
+}
+
+Uint32 get_color_generation(void) {
+    return generation;
+}
+
+int get_palette_count(void) {
+    return PALETTE_COUNT;
+}
+
+const Palette* get_palette(int palette) {
+    return &palettes[SDL_clamp(palette, 0, PALETTE_COUNT - 1)];
+}
+
+Uint32 color_escape_value(int value, int max_iterations) {
+    return lookup_color(&table, value, color_scale(max_iterations));
+}
+
+void color_span_scalar(const int* values, Uint32* pixels, int count, float scale, const ColorTable* color_table) {
+    for (int i = 0; i < count; i++) {
+        pixels[i] = lookup_color(color_table, values[i], scale);
+    }
+}
+
+void color_span(const int* values, Uint32* pixels, int count, int max_iterations) {
+    get_active_kernel()->color_span(values, pixels, count, color_scale(max_iterations), &table);
+}
+
+void color_preview_span(const int* values, Uint32* pixels, int count, int max_iterations) {
+    get_active_kernel()->color_span(values, pixels, count, color_scale(max_iterations), &preview_table);
+}
+
+typedef struct {
+    FrameBuffer* fb;
+    int max_iterations;
+} ColorJob;
+
+static void color_row(void* context, int y) {
+    ColorJob* job = context;
+    int offset = y * job->fb->width;
+    color_span(job->fb->iterations + offset, job->fb->pixels + offset, job->fb->width, job->max_iterations);
+}
+
+void color_frame(ThreadPool* pool, FrameBuffer* fb, int max_iterations) {
+    ColorJob job = {fb, max_iterations};
+    run_thread_pool(pool, color_row, &job, fb->height);
+    upload_frame_buffer(fb);
+}
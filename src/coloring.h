@@ -0,0 +1,89 @@
+#ifndef COLORING_H
+#define COLORING_H
+
+#include "mandelbrot.h"
+
+// Turns escape values into pixels, apart from computing them: a palette,
+// brightness or cycling change recolors the frame from FrameBuffer.iterations
+// without iterating. A palette is a gradient walked back and forth by the
+// cosine of the logarithm of the smooth escape count, normalized by the
+// iteration limit.
+//
+// Nothing of that is evaluated per pixel. The normalized count t is looked
+// up in a phase table indexed by the exponent and top mantissa bits of
+// t + COLOR_T_BIAS as a float, which spaces its entries evenly in log t like
+// the cosine itself, and the phase in a table holding one period of the
+// palette at the current brightness. Cycling only moves the offset added to
+// the phase, so animating it rebuilds nothing.
+
+#define MAX_PALETTE_STOPS 6
+
+#define COLOR_T_BIAS 0.0001f
+#define PHASE_MANTISSA_BITS 8
+// t + COLOR_T_BIAS lies in [2^-14, 2)
+#define PHASE_MIN_EXPONENT -14
+#define PHASE_TABLE_SIZE ((1 - PHASE_MIN_EXPONENT) << PHASE_MANTISSA_BITS)
+// float bits >> (23 - PHASE_MANTISSA_BITS) of 2^PHASE_MIN_EXPONENT
+#define PHASE_TABLE_BASE ((127 + PHASE_MIN_EXPONENT) << PHASE_MANTISSA_BITS)
+#define COLOR_TABLE_SIZE 1024
+
+typedef struct {
+    const char* name;
+    int stop_count;
+    SDL_Color stops[MAX_PALETTE_STOPS];
+} Palette;
+
+typedef struct {
+    int palette;            // index of one of the built-in palettes
+    double cycle;           // moves the colors along the palette, wraps at 1
+    double brightness;      // scales every color, 1 leaves the palette as it is
+} ColorSettings;
+
+typedef struct {
+    Uint32 phases[PHASE_TABLE_SIZE];    // below COLOR_TABLE_SIZE
+    Uint32 colors[COLOR_TABLE_SIZE];
+    Uint32 offset;                      // the cycle in color table entries
+} ColorTable;
+
+// Builds the tables for the default settings, before anything is colored
+void init_coloring(void);
+// One set of settings colors every frame, like the active kernel. Only
+// change it while nothing is being colored.
+void set_color_settings(const ColorSettings* settings);
+ColorSettings get_color_settings(void);
+// Changes with every set_color_settings(), so colors made earlier can tell they are stale
+Uint32 get_color_generation(void);
+int get_palette_count(void);
+const Palette* get_palette(int palette);
+
+// What lookup_color() multiplies the count and fraction bits of a value by
+static inline float color_scale(int max_iterations) {
+    return 1.0f / ((float)max_iterations * ESCAPE_FRACTION_STEPS);
+}
+
+// The scalar form of the kernels' color_span, see kernels.h
+static inline Uint32 lookup_color(const ColorTable* table, int value, float scale) {
+    // glitched pixels look like the set until they are repaired
+    if (value < 0 || (value & ESCAPE_INTERIOR)) {
+        return pack_argb(0, 0, 0);
+    }
+    
+    union {
+        float value;
+        Uint32 bits;
+    } t = {(float)(value >> ESCAPE_FLAG_BITS) * scale + COLOR_T_BIAS};
+    int index = (int)(t.bits >> (23 - PHASE_MANTISSA_BITS)) - PHASE_TABLE_BASE;
+    index = SDL_clamp(index, 0, PHASE_TABLE_SIZE - 1);
+    return table->colors[(table->phases[index] + table->offset) & (COLOR_TABLE_SIZE - 1)];
+}
+
+Uint32 color_escape_value(int value, int max_iterations);
+// Colors count consecutive values with the active kernel
+void color_span(const int* values, Uint32* pixels, int count, int max_iterations);
+// color_span() with the Julia preview's palette, which no color setting changes
+void color_preview_span(const int* values, Uint32* pixels, int count, int max_iterations);
+void color_span_scalar(const int* values, Uint32* pixels, int count, float scale, const ColorTable* color_table);
+// Recolors every pixel of the frame from its escape values and uploads it
+void color_frame(ThreadPool* pool, FrameBuffer* fb, int max_iterations);
+
+#endif
@@ -0,0 +1,37 @@
+#include "kernels.h"
+#include "double_double.h"
+
+// No cardioid test and no cycle detection here: both compare in plain double,
+// which is exactly the precision these zooms have already gone past.
+static int escape_time_dd(DoubleDouble zr, DoubleDouble zi, DoubleDouble cr, DoubleDouble ci, int max_iterations) {
+    for (int i = 0; i < max_iterations; i++) {
+        // z = z * z + c
+        DoubleDouble cross = dd_mul(zr, zi);
+        zr = dd_add(dd_sub(dd_sqr(zr), dd_sqr(zi)), cr);
+        zi = dd_add(dd_twice(cross), ci);
+        
+        double magnitude = zr.hi * zr.hi + zi.hi * zi.hi;
+        if (magnitude > 4)
+            return escaped_value(i, magnitude);
+    }
+    return interior_escape_value(max_iterations);
+}
+
+int escape_span_dd_scalar(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                          Complex step, int is_julia, Complex julia_c, int max_iterations) {
+    for (int i = 0; i < count; i++) {
+        int index = first + i * stride;
+        DoubleDouble real = two_sum(origin.real, index * step.real);
+        DoubleDouble imag = two_sum(origin.imag, index * step.imag);
+        real = fast_two_sum(real.hi, real.lo + origin_low.real);
+        imag = fast_two_sum(imag.hi, imag.lo + origin_low.imag);
+        
+        if (is_julia) {
+            out[i] = escape_time_dd(real, imag, dd_from_double(julia_c.real), dd_from_double(julia_c.imag),
+                                    max_iterations);
+        } else {
+            out[i] = escape_time_dd(dd_from_double(0.0), dd_from_double(0.0), real, imag, max_iterations);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+#include <math.h>
+
+// Unevaluated sum hi + lo with |lo| <= ulp(hi) / 2, about 106 bits of
+// mantissa. Built from error-free transformations: two_sum() and two_prod()
+// return a rounded result together with the exact rounding error.
+typedef struct {
+    double hi;
+    double lo;
+} DoubleDouble;
+
+static inline DoubleDouble dd_from_double(double a) {
+    DoubleDouble r = {a, 0.0};
+    return r;
+}
+
+// a + b exactly, for |a| >= |b|
+static inline DoubleDouble fast_two_sum(double a, double b) {
+    DoubleDouble r;
+    r.hi = a + b;
+    r.lo = b - (r.hi - a);
+    return r;
+}
+
+static inline DoubleDouble two_sum(double a, double b) {
+    DoubleDouble r;
+    r.hi = a + b;
+    double b_part = r.hi - a;
+    r.lo = (a - (r.hi - b_part)) + (b - b_part);
+    return r;
+}
+
+static inline DoubleDouble two_prod(double a, double b) {
+    DoubleDouble r;
+    r.hi = a * b;
+#ifdef FP_FAST_FMA
+    r.lo = fma(a, b, -r.hi);
+#else
+    // Dekker: split both factors into 26-bit halves whose products are exact
+    double a_big = 134217729.0 * a;
+    double a_hi = a_big - (a_big - a);
+    double a_lo = a - a_hi;
+    double b_big = 134217729.0 * b;
+    double b_hi = b_big - (b_big - b);
+    double b_lo = b - b_hi;
+    r.lo = ((a_hi * b_hi - r.hi) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+    return r;
+}
+
+// The low parts are added without their own error term. That bounds the
+// error by the magnitude of the operands rather than of the result, which
+// is what escape-time iteration needs.
+static inline DoubleDouble dd_add(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble s = two_sum(a.hi, b.hi);
+    return fast_two_sum(s.hi, s.lo + a.lo + b.lo);
+}
+
+static inline DoubleDouble dd_sub(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble s = two_sum(a.hi, -b.hi);
+    return fast_two_sum(s.hi, s.lo + a.lo - b.lo);
+}
+
+static inline DoubleDouble dd_mul(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble p = two_prod(a.hi, b.hi);
+    return fast_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+static inline DoubleDouble dd_sqr(DoubleDouble a) {
+    DoubleDouble p = two_prod(a.hi, a.hi);
+    return fast_two_sum(p.hi, p.lo + 2.0 * a.hi * a.lo);
+}
+
+static inline DoubleDouble dd_twice(DoubleDouble a) {
+    DoubleDouble r = {2.0 * a.hi, 2.0 * a.lo};
+    return r;
+}
+
+#endif
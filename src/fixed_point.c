@@ -0,0 +1,271 @@
+#include "fixed_point.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIMB_RANGE ldexp(1.0, FIXED_LIMB_BITS)
+#define SIGN_BIT ((FixedLimb)1 << (FIXED_LIMB_BITS - 1))
+
+// lowest product column formed by the truncated products, one guard limb below the result
+#define FIRST_COLUMN (FIXED_LIMBS - 2)
+
+int fixed_is_negative(const Fixed* a) {
+    return (a->limb[FIXED_LIMBS - 1] & SIGN_BIT) != 0;
+}
+
+int fixed_equals(const Fixed* a, const Fixed* b) {
+    return memcmp(a->limb, b->limb, sizeof(a->limb)) == 0;
+}
+
+void fixed_from_double(Fixed* out, double value) {
+    int negative = value < 0;
+    double magnitude = fabs(value);
+    
+    // peel off a limb at a time from the top, every step is exact
+    memset(out, 0, sizeof(*out));
+    magnitude = fmod(magnitude, LIMB_RANGE / 2);
+    for (int i = FIXED_LIMBS - 1; i >= 0 && magnitude > 0; i--) {
+        double limb = floor(magnitude);
+        out->limb[i] = (FixedLimb)limb;
+        magnitude = (magnitude - limb) * LIMB_RANGE;
+    }
+    if (negative) {
+        fixed_neg(out, out);
+    }
+}
+
+double fixed_to_double(const Fixed* a) {
+    Fixed magnitude = *a;
+    int negative = fixed_is_negative(a);
+    if (negative) {
+        fixed_neg(&magnitude, a);
+    }
+    
+    // 96 bits from the top limb down cover the 53 of a double wherever the top bit is
+    int top = FIXED_LIMBS - 1;
+    while (top > 0 && magnitude.limb[top] == 0) {
+        top--;
+    }
+    double value = 0.0;
+    for (int i = top; i >= 0 && (top - i) * FIXED_LIMB_BITS < 96; i--) {
+        value += ldexp((double)magnitude.limb[i], FIXED_LIMB_BITS * (i - (FIXED_LIMBS - 1)));
+    }
+    return negative ? -value : value;
+}
+
+// out = a / divisor for a non-negative a, rounded down
+static void divide_small(Fixed* out, const Fixed* a, FixedLimb divisor) {
+    FixedWide remainder = 0;
+    for (int i = FIXED_LIMBS - 1; i >= 0; i--) {
+        FixedWide current = (remainder << FIXED_LIMB_BITS) | a->limb[i];
+        out->limb[i] = (FixedLimb)(current / divisor);
+        remainder = current % divisor;
+    }
+}
+
+int fixed_from_string(Fixed* out, const char* text) {
+    const char* p = text;
+    int negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    
+    // the digits, and how many of them come before the decimal point
+    const char* digits = p;
+    int digit_count = 0;
+    int point = -1;
+    for (; *p; p++) {
+        if (*p >= '0' && *p <= '9') {
+            digit_count++;
+        } else if (*p == '.' && point < 0) {
+            point = digit_count;
+        } else {
+            break;
+        }
+    }
+    const char* digits_end = p;
+    if (digit_count == 0) {
+        return 0;
+    }
+    if (point < 0) {
+        point = digit_count;
+    }
+    if (*p == 'e' || *p == 'E') {
+        char* end;
+        long exponent = strtol(p + 1, &end, 10);
+        if (end == p + 1) {
+            return 0;
+        }
+        // far past either end the number overflows or rounds to zero anyway
+        point += (int)SDL_clamp(exponent, -1000, 1000);
+        p = end;
+    }
+    if (*p != '\0') {
+        return 0;
+    }
+    
+    // the fraction from its last digit up: f = (f + digit) / 10
+    memset(out, 0, sizeof(*out));
+    int index = digit_count;
+    for (const char* c = digits_end - 1; c >= digits; c--) {
+        if (*c == '.') {
+            continue;
+        }
+        if (--index < point) {
+            break;
+        }
+        out->limb[FIXED_LIMBS - 1] += (FixedLimb)(*c - '0');
+        divide_small(out, out, 10);
+    }
+    for (int i = point; i < 0; i++) {
+        divide_small(out, out, 10);
+    }
+    
+    // the integer part has to fit the top limb next to its sign bit
+    FixedLimb integer = 0;
+    index = 0;
+    for (const char* c = digits; c < digits_end && index < point; c++) {
+        if (*c == '.') {
+            continue;
+        }
+        if (integer > (SIGN_BIT - 1 - 9) / 10) {
+            return 0;
+        }
+        integer = integer * 10 + (FixedLimb)(*c - '0');
+        index++;
+    }
+    for (; index < point; index++) {
+        if (integer > (SIGN_BIT - 1) / 10) {
+            return 0;
+        }
+        integer *= 10;
+    }
+    out->limb[FIXED_LIMBS - 1] = integer;
+    
+    if (negative) {
+        fixed_neg(out, out);
+    }
+    return 1;
+}
+
+void fixed_add(Fixed* out, const Fixed* a, const Fixed* b) {
+    FixedWide carry = 0;
+    for (int i = 0; i < FIXED_LIMBS; i++) {
+        carry += (FixedWide)a->limb[i] + b->limb[i];
+        out->limb[i] = (FixedLimb)carry;
+        carry >>= FIXED_LIMB_BITS;
+    }
+}
+
+void fixed_sub(Fixed* out, const Fixed* a, const Fixed* b) {
+    FixedWide borrow = 0;
+    for (int i = 0; i < FIXED_LIMBS; i++) {
+        FixedWide difference = (FixedWide)a->limb[i] - b->limb[i] - borrow;
+        out->limb[i] = (FixedLimb)difference;
+        borrow = (difference >> FIXED_LIMB_BITS) & 1;
+    }
+}
+
+void fixed_neg(Fixed* out, const Fixed* a) {
+    FixedWide carry = 1;
+    for (int i = 0; i < FIXED_LIMBS; i++) {
+        carry += (FixedLimb)~a->limb[i];
+        out->limb[i] = (FixedLimb)carry;
+        carry >>= FIXED_LIMB_BITS;
+    }
+}
+
+void fixed_add_double(Fixed* out, const Fixed* a, double b) {
+    Fixed addend;
+    fixed_from_double(&addend, b);
+    fixed_add(out, a, &addend);
+}
+
+double fixed_difference(const Fixed* a, const Fixed* b) {
+    Fixed difference;
+    fixed_sub(&difference, a, b);
+    return fixed_to_double(&difference);
+}
+
+// Column accumulator, high * 2^(2 * FIXED_LIMB_BITS) + low. A column has at
+// most FIXED_LIMBS products, so high never gets near a limb's worth.
+typedef struct {
+    FixedWide low;
+    FixedLimb high;
+} Accumulator;
+
+static inline void accumulate(Accumulator* sum, FixedWide value) {
+    sum->low += value;
+    sum->high += sum->low < value;
+}
+
+// Emits the low limb of the accumulator and carries the rest to the next column
+static inline FixedLimb next_column(Accumulator* sum) {
+    FixedLimb limb = (FixedLimb)sum->low;
+    sum->low = (sum->low >> FIXED_LIMB_BITS) | ((FixedWide)sum->high << FIXED_LIMB_BITS);
+    sum->high = 0;
+    return limb;
+}
+
+static const FixedLimb* magnitude_of(const Fixed* a, Fixed* scratch) {
+    if (!fixed_is_negative(a)) {
+        return a->limb;
+    }
+    fixed_neg(scratch, a);
+    return scratch->limb;
+}
+
+void fixed_mul(Fixed* out, const Fixed* a, const Fixed* b) {
+    Fixed scratch_a, scratch_b;
+    int negative = fixed_is_negative(a) != fixed_is_negative(b);
+    const FixedLimb* x = magnitude_of(a, &scratch_a);
+    const FixedLimb* y = magnitude_of(b, &scratch_b);
+    
+    // column by column (Comba), column k holds every x[i] * y[k - i]
+    FixedLimb result[FIXED_LIMBS];
+    Accumulator sum = {0, 0};
+    for (int k = FIRST_COLUMN; k < 2 * FIXED_LIMBS - 1; k++) {
+        int first = k < FIXED_LIMBS ? 0 : k - (FIXED_LIMBS - 1);
+        int last = k < FIXED_LIMBS ? k : FIXED_LIMBS - 1;
+        for (int i = first; i <= last; i++) {
+            accumulate(&sum, (FixedWide)x[i] * y[k - i]);
+        }
+        FixedLimb limb = next_column(&sum);
+        if (k >= FIXED_LIMBS - 1) {
+            result[k - (FIXED_LIMBS - 1)] = limb;
+        }
+    }
+    
+    memcpy(out->limb, result, sizeof(result));
+    if (negative) {
+        fixed_neg(out, out);
+    }
+}
+
+void fixed_square(Fixed* out, const Fixed* a) {
+    Fixed scratch;
+    const FixedLimb* x = magnitude_of(a, &scratch);
+    
+    // x[i] * x[j] and x[j] * x[i] are the same product, form it once and double it
+    FixedLimb result[FIXED_LIMBS];
+    Accumulator sum = {0, 0};
+    for (int k = FIRST_COLUMN; k < 2 * FIXED_LIMBS - 1; k++) {
+        int first = k < FIXED_LIMBS ? 0 : k - (FIXED_LIMBS - 1);
+        Accumulator cross = {0, 0};
+        for (int i = first; i < k - i; i++) {
+            accumulate(&cross, (FixedWide)x[i] * x[k - i]);
+        }
+        accumulate(&sum, cross.low << 1);
+        sum.high += (cross.high << 1) | (FixedLimb)(cross.low >> (2 * FIXED_LIMB_BITS - 1));
+        if ((k & 1) == 0) {
+            accumulate(&sum, (FixedWide)x[k / 2] * x[k / 2]);
+        }
+        
+        FixedLimb limb = next_column(&sum);
+        if (k >= FIXED_LIMBS - 1) {
+            result[k - (FIXED_LIMBS - 1)] = limb;
+        }
+    }
+    
+    memcpy(out->limb, result, sizeof(result));
+}
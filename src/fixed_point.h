@@ -0,0 +1,50 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <SDL.h>
+
+// 512-bit numbers in limbs of the widest integer whose products the compiler
+// can form directly, limb[0] least significant. The top limb is the integer
+// part, the rest are fraction bits, about 1e-135 resolution with 64-bit limbs.
+#ifdef __SIZEOF_INT128__
+typedef Uint64 FixedLimb;
+typedef unsigned __int128 FixedWide;
+#define FIXED_LIMB_BITS 64
+#else
+typedef Uint32 FixedLimb;
+typedef Uint64 FixedWide;
+#define FIXED_LIMB_BITS 32
+#endif
+
+#define FIXED_LIMBS (512 / FIXED_LIMB_BITS)
+#define FIXED_FRACTION_BITS (FIXED_LIMB_BITS * (FIXED_LIMBS - 1))
+
+// Two's complement fixed-point number, the integer part is a signed limb
+typedef struct {
+    FixedLimb limb[FIXED_LIMBS];
+} Fixed;
+
+void fixed_from_double(Fixed* out, double value);
+double fixed_to_double(const Fixed* a);
+// Parses a decimal such as "-0.7436438870371587e-3" to the full fixed
+// precision. Returns 0 for malformed text or an integer part out of range.
+int fixed_from_string(Fixed* out, const char* text);
+int fixed_is_negative(const Fixed* a);
+int fixed_equals(const Fixed* a, const Fixed* b);
+
+// All operations may take out aliased with an input.
+void fixed_add(Fixed* out, const Fixed* a, const Fixed* b);
+void fixed_sub(Fixed* out, const Fixed* a, const Fixed* b);
+void fixed_neg(Fixed* out, const Fixed* a);
+// a + b for a double b, exact as long as b is not below the fixed resolution
+void fixed_add_double(Fixed* out, const Fixed* a, double b);
+// a - b rounded to the nearest double, for two nearby numbers
+double fixed_difference(const Fixed* a, const Fixed* b);
+
+// Products are truncated: the limbs below the result are never formed, which
+// costs at most a couple of units in the last limb and saves almost half the
+// partial products. fixed_square() also uses the symmetry of a * a.
+void fixed_mul(Fixed* out, const Fixed* a, const Fixed* b);
+void fixed_square(Fixed* out, const Fixed* a);
+
+#endif
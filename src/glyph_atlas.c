@@ -0,0 +1,272 @@
+#include "glyph_atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL_ttf.h>
+
+#define ATLAS_WIDTH 512
+// empty pixels between glyphs so filtering does not pick up a neighbour
+#define GLYPH_PADDING 1
+
+#define BITMAP_WIDTH 5
+#define BITMAP_HEIGHT 7
+#define BITMAP_SCALE 2
+
+// Tried in order after MANDELBROT_FONT
+static const char* font_paths[] = {
+    "C:/Windows/Fonts/arial.ttf",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+    "/usr/share/fonts/liberation/LiberationSans-Regular.ttf",
+    "/usr/share/fonts/noto/NotoSans-Regular.ttf",
+    "/System/Library/Fonts/Supplemental/Arial.ttf",
+    "/Library/Fonts/Arial.ttf"
+};
+
+#define FONT_PATH_COUNT (int)(sizeof(font_paths) / sizeof(font_paths[0]))
+
+// FIRST_GLYPH .. LAST_GLYPH as 5x7 bitmaps, one byte per column with bit 0 the top row
+static const Uint8 bitmap_font[GLYPH_COUNT][BITMAP_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x00, 0x7F, 0x10, 0x28, 0x44}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02}
+};
+
+static int glyph_index(char c) {
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+        c = '?';
+    }
+    return c - FIRST_GLYPH;
+}
+
+// Places the glyphs, whose sizes are already set, left to right in rows
+// ATLAS_WIDTH wide and returns the height of all rows
+static int layout_glyphs(GlyphAtlas* atlas) {
+    int x = 0, y = 0, row_height = 0;
+    
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        SDL_Rect* source = &atlas->glyphs[i].source;
+        if (x + source->w > ATLAS_WIDTH) {
+            x = 0;
+            y += row_height + GLYPH_PADDING;
+            row_height = 0;
+        }
+        source->x = x;
+        source->y = y;
+        x += source->w + GLYPH_PADDING;
+        row_height = SDL_max(row_height, source->h);
+    }
+    return y + row_height;
+}
+
+static SDL_Surface* create_atlas_surface(GlyphAtlas* atlas) {
+    int height = layout_glyphs(atlas);
+    if (height <= 0) {
+        return NULL;
+    }
+    return SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, height, 32, SDL_PIXELFORMAT_ARGB8888);
+}
+
+static TTF_Font* open_font(int point_size) {
+    const char* forced = getenv("MANDELBROT_FONT");
+    if (forced) {
+        TTF_Font* font = TTF_OpenFont(forced, point_size);
+        if (font) {
+            return font;
+        }
+        printf("Font '%s' could not be opened: %s\n", forced, TTF_GetError());
+    }
+    
+    for (int i = 0; i < FONT_PATH_COUNT; i++) {
+        TTF_Font* font = TTF_OpenFont(font_paths[i], point_size);
+        if (font) {
+            return font;
+        }
+    }
+    return NULL;
+}
+
+// White glyphs with the font's coverage as alpha, text color comes from the vertices
+static SDL_Surface* render_font_atlas(GlyphAtlas* atlas, TTF_Font* font) {
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface* rendered[GLYPH_COUNT];
+    
+    atlas->line_height = TTF_FontHeight(font);
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        Glyph* glyph = &atlas->glyphs[i];
+        int advance = 0;
+        TTF_GlyphMetrics(font, FIRST_GLYPH + i, NULL, NULL, NULL, NULL, &advance);
+        rendered[i] = TTF_RenderGlyph_Blended(font, FIRST_GLYPH + i, white);
+        glyph->advance = advance;
+        glyph->source.w = rendered[i] ? rendered[i]->w : 0;
+        glyph->source.h = rendered[i] ? rendered[i]->h : 0;
+    }
+    
+    SDL_Surface* surface = create_atlas_surface(atlas);
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        if (!rendered[i]) {
+            continue;
+        }
+        // copy the alpha instead of blending it onto the empty atlas
+        if (surface) {
+            SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(rendered[i], NULL, surface, &atlas->glyphs[i].source);
+        }
+        SDL_FreeSurface(rendered[i]);
+    }
+    return surface;
+}
+
+static SDL_Surface* render_bitmap_atlas(GlyphAtlas* atlas) {
+    atlas->line_height = BITMAP_HEIGHT * BITMAP_SCALE;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        atlas->glyphs[i].source.w = BITMAP_WIDTH * BITMAP_SCALE;
+        atlas->glyphs[i].source.h = BITMAP_HEIGHT * BITMAP_SCALE;
+        atlas->glyphs[i].advance = (BITMAP_WIDTH + 1) * BITMAP_SCALE;
+    }
+    
+    SDL_Surface* surface = create_atlas_surface(atlas);
+    if (!surface) {
+        return NULL;
+    }
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        const SDL_Rect* source = &atlas->glyphs[i].source;
+        for (int column = 0; column < BITMAP_WIDTH; column++) {
+            for (int row = 0; row < BITMAP_HEIGHT; row++) {
+                if (!(bitmap_font[i][column] & (1 << row)))
+                    continue;
+                SDL_Rect dot = {source->x + column * BITMAP_SCALE, source->y + row * BITMAP_SCALE,
+                                BITMAP_SCALE, BITMAP_SCALE};
+                SDL_FillRect(surface, &dot, 0xFFFFFFFFu);
+            }
+        }
+    }
+    return surface;
+}
+
+int init_glyph_atlas(GlyphAtlas* atlas, SDL_Renderer* renderer, int point_size) {
+    atlas->texture = NULL;
+    atlas->quad_count = 0;
+    // two triangles per quad, over its corners in the order queue_text() writes them
+    for (int quad = 0; quad < MAX_TEXT_QUADS; quad++) {
+        static const int corners[6] = {0, 1, 2, 2, 1, 3};
+        for (int i = 0; i < 6; i++) {
+            atlas->indices[quad * 6 + i] = quad * 4 + corners[i];
+        }
+    }
+    
+    SDL_Surface* surface = NULL;
+    if (TTF_Init() == 0) {
+        TTF_Font* font = open_font(point_size);
+        if (font) {
+            surface = render_font_atlas(atlas, font);
+            TTF_CloseFont(font);
+        }
+        TTF_Quit();
+    }
+    if (!surface) {
+        printf("No TrueType font found, using the built-in bitmap font\n");
+        surface = render_bitmap_atlas(atlas);
+    }
+    if (!surface) {
+        printf("Glyph atlas could not be created: %s\n", SDL_GetError());
+        return 0;
+    }
+    
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    atlas->texture_width = surface->w;
+    atlas->texture_height = surface->h;
+    SDL_FreeSurface(surface);
+    if (!atlas->texture) {
+        printf("Glyph atlas texture could not be created: %s\n", SDL_GetError());
+        return 0;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+    return 1;
+}
+
+int measure_text(const GlyphAtlas* atlas, const char* text) {
+    int width = 0;
+    for (const char* c = text; *c; c++) {
+        width += atlas->glyphs[glyph_index(*c)].advance;
+    }
+    return width;
+}
+
+void queue_text(GlyphAtlas* atlas, SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color) {
+    if (!atlas->texture) {
+        return;
+    }
+    
+    float scale_u = 1.0f / atlas->texture_width;
+    float scale_v = 1.0f / atlas->texture_height;
+    int pen = x;
+    for (const char* c = text; *c; c++) {
+        const Glyph* glyph = &atlas->glyphs[glyph_index(*c)];
+        if (*c != ' ' && glyph->source.w > 0) {
+            if (atlas->quad_count == MAX_TEXT_QUADS) {
+                flush_text(atlas, renderer);
+            }
+            
+            const SDL_Rect* source = &glyph->source;
+            float left = (float)pen, top = (float)y;
+            float right = left + source->w, bottom = top + source->h;
+            float u0 = source->x * scale_u, v0 = source->y * scale_v;
+            float u1 = (source->x + source->w) * scale_u, v1 = (source->y + source->h) * scale_v;
+            
+            SDL_Vertex* corner = &atlas->vertices[atlas->quad_count * 4];
+            corner[0] = (SDL_Vertex){{left, top}, color, {u0, v0}};
+            corner[1] = (SDL_Vertex){{right, top}, color, {u1, v0}};
+            corner[2] = (SDL_Vertex){{left, bottom}, color, {u0, v1}};
+            corner[3] = (SDL_Vertex){{right, bottom}, color, {u1, v1}};
+            atlas->quad_count++;
+        }
+        pen += glyph->advance;
+    }
+}
+
+void flush_text(GlyphAtlas* atlas, SDL_Renderer* renderer) {
+    if (atlas->quad_count == 0) {
+        return;
+    }
+    SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, atlas->quad_count * 4,
+                       atlas->indices, atlas->quad_count * 6);
+    atlas->quad_count = 0;
+}
+
+void destroy_glyph_atlas(GlyphAtlas* atlas) {
+    if (atlas->texture) {
+        SDL_DestroyTexture(atlas->texture);
+        atlas->texture = NULL;
+    }
+}
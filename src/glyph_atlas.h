@@ -0,0 +1,44 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <SDL.h>
+
+// Printable ASCII, anything else is drawn as '?'
+#define FIRST_GLYPH ' '
+#define LAST_GLYPH '~'
+#define GLYPH_COUNT (LAST_GLYPH - FIRST_GLYPH + 1)
+
+// glyphs queue_text() holds before it has to flush
+#define MAX_TEXT_QUADS 512
+
+typedef struct {
+    SDL_Rect source;    // in the atlas texture
+    int advance;        // pen movement to the next glyph
+} Glyph;
+
+// All glyphs rendered once into a single texture, so text costs no surface
+// or texture per frame and a whole frame's text is one SDL_RenderGeometry() call
+typedef struct {
+    SDL_Texture* texture;
+    int texture_width;
+    int texture_height;
+    int line_height;
+    Glyph glyphs[GLYPH_COUNT];
+    SDL_Vertex vertices[MAX_TEXT_QUADS * 4];
+    int indices[MAX_TEXT_QUADS * 6];
+    int quad_count;
+} GlyphAtlas;
+
+// Renders the first TrueType font that opens, MANDELBROT_FONT and then a list
+// of common system paths, or an embedded 5x7 bitmap font if none does.
+// Returns 0 only if the atlas texture could not be created.
+int init_glyph_atlas(GlyphAtlas* atlas, SDL_Renderer* renderer, int point_size);
+// width of text in pixels
+int measure_text(const GlyphAtlas* atlas, const char* text);
+// Adds text with its top left corner at (x, y) to the batch, which is drawn
+// by flush_text(), or earlier when it is full
+void queue_text(GlyphAtlas* atlas, SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color);
+void flush_text(GlyphAtlas* atlas, SDL_Renderer* renderer);
+void destroy_glyph_atlas(GlyphAtlas* atlas);
+
+#endif
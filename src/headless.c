@@ -0,0 +1,279 @@
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perturbation.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// the longest a deflate block can be stored uncompressed
+#define STORED_BLOCK_SIZE 65535
+
+typedef enum {
+    FORMAT_PPM,
+    FORMAT_PNG
+} ImageFormat;
+
+// Messages go to stderr here, stdout may be carrying the image.
+
+static void put_be32(Uint8* bytes, Uint32 value) {
+    bytes[0] = (Uint8)(value >> 24);
+    bytes[1] = (Uint8)(value >> 16);
+    bytes[2] = (Uint8)(value >> 8);
+    bytes[3] = (Uint8)value;
+}
+
+// 8-bit RGB rows of the frame, each behind a PNG filter byte when filtered is set
+static Uint8* pack_rgb(const FrameBuffer* fb, int filtered, size_t* size) {
+    size_t row_size = (size_t)fb->width * 3 + (filtered ? 1 : 0);
+    Uint8* rgb = malloc(row_size * fb->height);
+    if (!rgb) {
+        return NULL;
+    }
+    
+    for (int y = 0; y < fb->height; y++) {
+        Uint8* row = rgb + y * row_size;
+        if (filtered) {
+            *row++ = 0;
+        }
+        for (int x = 0; x < fb->width; x++) {
+            Uint32 pixel = fb->pixels[y * fb->width + x];
+            *row++ = (Uint8)(pixel >> 16);
+            *row++ = (Uint8)(pixel >> 8);
+            *row++ = (Uint8)pixel;
+        }
+    }
+    *size = row_size * fb->height;
+    return rgb;
+}
+
+static int write_ppm(FILE* file, const FrameBuffer* fb) {
+    size_t size;
+    Uint8* rgb = pack_rgb(fb, 0, &size);
+    if (!rgb) {
+        return 0;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+    size_t written = fwrite(rgb, 1, size, file);
+    free(rgb);
+    return written == size;
+}
+
+typedef struct {
+    FILE* file;
+    Uint32 crc;     // of the chunk being written, type included
+} ChunkWriter;
+
+static void chunk_data(ChunkWriter* writer, const void* data, size_t size) {
+    fwrite(data, 1, size, writer->file);
+    writer->crc = SDL_crc32(writer->crc, data, size);
+}
+
+static void begin_chunk(ChunkWriter* writer, const char* type, Uint32 length) {
+    Uint8 bytes[4];
+    put_be32(bytes, length);
+    fwrite(bytes, 1, 4, writer->file);
+    writer->crc = 0;
+    chunk_data(writer, type, 4);
+}
+
+static void end_chunk(ChunkWriter* writer) {
+    Uint8 bytes[4];
+    put_be32(bytes, writer->crc);
+    fwrite(bytes, 1, 4, writer->file);
+}
+
+static Uint32 adler32(const Uint8* data, size_t size) {
+    Uint32 a = 1, b = 0;
+    for (size_t i = 0; i < size; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+// The image data goes into stored (uncompressed) deflate blocks, which every
+// PNG reader accepts and which need no compressor.
+static int write_png(FILE* file, const FrameBuffer* fb) {
+    static const Uint8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    size_t size;
+    Uint8* scanlines = pack_rgb(fb, 1, &size);
+    if (!scanlines) {
+        return 0;
+    }
+    
+    ChunkWriter writer = {file, 0};
+    fwrite(signature, 1, sizeof(signature), file);
+    
+    // 8-bit RGB, deflate, adaptive filtering, no interlace
+    Uint8 header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, 2, 0, 0, 0};
+    put_be32(header, fb->width);
+    put_be32(header + 4, fb->height);
+    begin_chunk(&writer, "IHDR", sizeof(header));
+    chunk_data(&writer, header, sizeof(header));
+    end_chunk(&writer);
+    
+    size_t blocks = (size + STORED_BLOCK_SIZE - 1) / STORED_BLOCK_SIZE;
+    begin_chunk(&writer, "IDAT", (Uint32)(2 + blocks * 5 + size + 4));
+    static const Uint8 zlib_header[2] = {0x78, 0x01};
+    chunk_data(&writer, zlib_header, sizeof(zlib_header));
+    for (size_t offset = 0; offset < size; offset += STORED_BLOCK_SIZE) {
+        size_t length = SDL_min(size - offset, STORED_BLOCK_SIZE);
+        Uint8 block_header[5] = {
+            offset + length == size,    // final block flag, type 0 (stored)
+            (Uint8)length, (Uint8)(length >> 8),
+            (Uint8)~length, (Uint8)(~length >> 8)
+        };
+        chunk_data(&writer, block_header, sizeof(block_header));
+        chunk_data(&writer, scanlines + offset, length);
+    }
+    Uint8 checksum[4];
+    put_be32(checksum, adler32(scanlines, size));
+    chunk_data(&writer, checksum, sizeof(checksum));
+    end_chunk(&writer);
+    
+    begin_chunk(&writer, "IEND", 0);
+    end_chunk(&writer);
+    
+    free(scanlines);
+    return !ferror(file);
+}
+
+static int ends_with(const char* text, const char* suffix) {
+    size_t text_length = strlen(text);
+    size_t suffix_length = strlen(suffix);
+    return text_length >= suffix_length && SDL_strcasecmp(text + text_length - suffix_length, suffix) == 0;
+}
+
+static int write_image(const char* path, ImageFormat format, const FrameBuffer* fb) {
+    FILE* file = stdout;
+    if (strcmp(path, "-") == 0) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        file = fopen(path, "wb");
+        if (!file) {
+            fprintf(stderr, "Could not open '%s' for writing\n", path);
+            return 0;
+        }
+    }
+    
+    int written = format == FORMAT_PNG ? write_png(file, fb) : write_ppm(file, fb);
+    if (file == stdout) {
+        written = fflush(stdout) == 0 && written;
+    } else {
+        written = fclose(file) == 0 && written;
+    }
+    if (!written) {
+        fprintf(stderr, "Could not write the image to '%s'\n", path);
+    }
+    return written;
+}
+
+static int render_image(FrameBuffer* frame, ViewPort view, int is_julia, Complex julia_c,
+                        RenderStrategy strategy, int fixed_limit) {
+    ThreadPool* pool = create_thread_pool(0);
+    if (!pool) {
+        fprintf(stderr, "Thread pool could not be created\n");
+        return 0;
+    }
+    
+    // the same precision and limit the explorer would pick for this view
+    int max_iterations = choose_iteration_limit(view, fixed_limit);
+    Precision precision = choose_precision(view, frame->width, frame->height, max_iterations);
+    ReferenceOrbit* reference = NULL;
+    if (precision == PRECISION_PERTURBATION) {
+        reference = create_view_reference(view, is_julia, julia_c, max_iterations);
+    }
+    
+    PixelGrid grid;
+    if (reference) {
+        grid = make_perturbation_grid(view, frame->width, frame->height, reference);
+    } else {
+        grid = make_pixel_grid(view, frame->width, frame->height, is_julia, julia_c, max_iterations);
+        grid.precision = precision == PRECISION_PERTURBATION ? PRECISION_DOUBLE_DOUBLE : precision;
+    }
+    
+    render(pool, frame, &grid, strategy);
+    fprintf(stderr, "Rendered %dx%d in %s precision, iteration limit %d\n",
+            frame->width, frame->height, precision_name(grid.precision), max_iterations);
+    
+    destroy_reference_orbit(reference);
+    destroy_thread_pool(pool);
+    return 1;
+}
+
+int run_headless(int argc, char* argv[], RenderStrategy strategy, int fixed_limit) {
+    const char* center_real = "-0.5";
+    const char* center_imag = "0";
+    double scale = HOME_WIDTH;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    int is_julia = 0;
+    Complex julia_c = {0.0, 0.0};
+    const char* output = "-";
+    const char* format_name = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--center") == 0 && i + 2 < argc) {
+            center_real = argv[++i];
+            center_imag = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                width = height = 0;
+            }
+        } else if (strcmp(argv[i], "--julia") == 0 && i + 2 < argc) {
+            is_julia = 1;
+            julia_c.real = atof(argv[++i]);
+            julia_c.imag = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format_name = argv[++i];
+        }
+    }
+    
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "--size expects WIDTHxHEIGHT in pixels\n");
+        return 1;
+    }
+    if (!(scale > 0.0)) {
+        fprintf(stderr, "--scale expects a positive view width\n");
+        return 1;
+    }
+    
+    ImageFormat format = ends_with(output, ".png") ? FORMAT_PNG : FORMAT_PPM;
+    if (format_name) {
+        if (SDL_strcasecmp(format_name, "png") == 0) {
+            format = FORMAT_PNG;
+        } else if (SDL_strcasecmp(format_name, "ppm") == 0) {
+            format = FORMAT_PPM;
+        } else {
+            fprintf(stderr, "Unknown format '%s', expected ppm or png\n", format_name);
+            return 1;
+        }
+    }
+    
+    // square pixels, and the zoom the explorer would show for this width
+    ViewPort view = make_view(0.0, 0.0, scale, scale * height / width);
+    view.zoom = HOME_WIDTH / scale;
+    if (!fixed_from_string(&view.center_real, center_real) ||
+        !fixed_from_string(&view.center_imag, center_imag)) {
+        fprintf(stderr, "--center expects two decimal numbers\n");
+        return 1;
+    }
+    
+    FrameBuffer frame;
+    if (!init_frame_buffer(&frame, NULL, width, height)) {
+        return 1;
+    }
+    int succeeded = render_image(&frame, view, is_julia, julia_c, strategy, fixed_limit) &&
+                    write_image(output, format, &frame);
+    destroy_frame_buffer(&frame);
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "mandelbrot.h"
+
+// Renders a single image described by the command line to a PPM or PNG file,
+// or to stdout, without initializing SDL video. Options:
+//   --center RE IM     view center as decimals of any length (default -0.5 0)
+//   --scale WIDTH      width of the view in the complex plane (default 3)
+//   --size WxH         image size in pixels (default 800x600)
+//   --julia RE IM      render the Julia set of this c instead
+//   --output PATH      file to write, "-" for stdout (default)
+//   --format ppm|png   defaults to png for paths ending in .png, else ppm
+// The kernels must already be initialized. Returns the exit status for main().
+int run_headless(int argc, char* argv[], RenderStrategy strategy, int fixed_limit);
+
+#endif
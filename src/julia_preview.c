@@ -0,0 +1,146 @@
+#include "julia_preview.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coloring.h"
+
+static void compute_preview(int* values, int size, Complex julia_c, int max_iterations) {
+    ViewPort preview_view = make_view(0.0, 0.0, HOME_WIDTH, HOME_WIDTH);
+    PixelGrid grid = make_pixel_grid(preview_view, size, size, 1, julia_c, max_iterations);
+    grid.precision = choose_precision(preview_view, size, size, max_iterations);
+    // the HUD and the I key report the main view's work only
+    grid.untracked = 1;
+    
+    for (int y = 0; y < size; y++) {
+        compute_row(&grid, values + y * size, y, 0, size);
+    }
+}
+
+// Main thread only, it uploads the texture
+static void color_preview(JuliaPreview* preview) {
+    FrameBuffer* frame = &preview->frame;
+    color_preview_span(frame->iterations, frame->pixels, frame->width * frame->height, preview->shown_limit);
+    upload_frame_buffer(frame);
+}
+
+static int preview_thread(void* data) {
+    JuliaPreview* preview = data;
+    // the main view's render threads come first
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    
+    SDL_LockMutex(preview->lock);
+    while (!preview->quit) {
+        if (!preview->requested) {
+            SDL_CondWait(preview->wake, preview->lock);
+            continue;
+        }
+        Complex c = preview->request_c;
+        int max_iterations = preview->request_limit;
+        preview->requested = 0;
+        SDL_UnlockMutex(preview->lock);
+        
+        compute_preview(preview->work_values, preview->size, c, max_iterations);
+        
+        // even when a newer request is waiting this one is shown, so a
+        // preview that is always being dragged still updates
+        SDL_LockMutex(preview->lock);
+        int* finished = preview->work_values;
+        preview->work_values = preview->ready_values;
+        preview->ready_values = finished;
+        preview->ready_limit = max_iterations;
+        preview->ready = 1;
+        if (preview->ready_event != (Uint32)-1) {
+            SDL_Event event = {0};
+            event.type = preview->ready_event;
+            SDL_PushEvent(&event);
+        }
+    }
+    SDL_UnlockMutex(preview->lock);
+    return 0;
+}
+
+int init_julia_preview(JuliaPreview* preview, SDL_Renderer* renderer, int size) {
+    memset(preview, 0, sizeof(*preview));
+    preview->size = size;
+    
+    if (!init_frame_buffer(&preview->frame, renderer, size, size)) {
+        return 0;
+    }
+    preview->ready_values = malloc(sizeof(int) * size * size);
+    preview->work_values = malloc(sizeof(int) * size * size);
+    preview->lock = SDL_CreateMutex();
+    preview->wake = SDL_CreateCond();
+    // wakes the main loop, which may be blocked waiting for input
+    preview->ready_event = SDL_RegisterEvents(1);
+    if (!preview->ready_values || !preview->work_values || !preview->lock || !preview->wake) {
+        printf("Julia preview could not be created: %s\n", SDL_GetError());
+        return 0;
+    }
+    
+    preview->thread = SDL_CreateThread(preview_thread, "julia preview", preview);
+    if (!preview->thread) {
+        printf("Julia preview thread could not be created: %s\n", SDL_GetError());
+        return 0;
+    }
+    return 1;
+}
+
+void request_julia_preview(JuliaPreview* preview, Complex c, int max_iterations) {
+    if (!preview->thread || (preview->posted && c.real == preview->posted_c.real &&
+                             c.imag == preview->posted_c.imag && max_iterations == preview->posted_limit)) {
+        return;
+    }
+    preview->posted = 1;
+    preview->posted_c = c;
+    preview->posted_limit = max_iterations;
+    
+    SDL_LockMutex(preview->lock);
+    preview->request_c = c;
+    preview->request_limit = max_iterations;
+    preview->requested = 1;
+    SDL_CondSignal(preview->wake);
+    SDL_UnlockMutex(preview->lock);
+}
+
+int update_julia_preview(JuliaPreview* preview) {
+    if (!preview->thread) {
+        return 0;
+    }
+    
+    int swapped = 0;
+    SDL_LockMutex(preview->lock);
+    if (preview->ready) {
+        memcpy(preview->frame.iterations, preview->ready_values, sizeof(int) * preview->size * preview->size);
+        preview->shown_limit = preview->ready_limit;
+        preview->ready = 0;
+        swapped = 1;
+    }
+    SDL_UnlockMutex(preview->lock);
+    
+    if (swapped) {
+        color_preview(preview);
+        preview->shown = 1;
+    }
+    return preview->shown;
+}
+
+void destroy_julia_preview(JuliaPreview* preview) {
+    if (preview->thread) {
+        SDL_LockMutex(preview->lock);
+        preview->quit = 1;
+        SDL_CondSignal(preview->wake);
+        SDL_UnlockMutex(preview->lock);
+        SDL_WaitThread(preview->thread, NULL);
+        preview->thread = NULL;
+    }
+    if (preview->wake) {
+        SDL_DestroyCond(preview->wake);
+    }
+    if (preview->lock) {
+        SDL_DestroyMutex(preview->lock);
+    }
+    free(preview->ready_values);
+    free(preview->work_values);
+    destroy_frame_buffer(&preview->frame);
+    memset(preview, 0, sizeof(*preview));
+}
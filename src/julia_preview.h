@@ -0,0 +1,43 @@
+#ifndef JULIA_PREVIEW_H
+#define JULIA_PREVIEW_H
+
+#include "mandelbrot.h"
+
+// The Julia set of the point under the mouse, computed on a background
+// thread so the main view never waits for it. Requests replace each other,
+// the worker always computes the newest one and finished previews are
+// swapped in by update_julia_preview(). The worker only produces escape
+// values; they are colored on the main thread with the preview's own
+// palette (see coloring.c), so the preview stays apart from the main view.
+typedef struct {
+    FrameBuffer frame;          // the preview on screen, main thread only
+    int size;
+    int shown;                  // frame holds a finished preview
+    int shown_limit;            // iteration limit of the preview in frame
+    int posted;                 // posted_c and posted_limit are set
+    Complex posted_c;           // last request, a repeat of it is not recomputed
+    int posted_limit;
+    Uint32 ready_event;         // SDL event type pushed when a preview is finished
+
+    SDL_Thread* thread;
+    SDL_mutex* lock;            // guards everything below
+    SDL_cond* wake;
+    int quit;
+    int requested;
+    Complex request_c;
+    int request_limit;
+    int ready;                  // ready_values has not been swapped in yet
+    int ready_limit;
+    int* ready_values;
+    int* work_values;           // worker only
+} JuliaPreview;
+
+// Returns 0 if the preview could not be set up, the structure can still be destroyed
+int init_julia_preview(JuliaPreview* preview, SDL_Renderer* renderer, int size);
+// Asks for the preview of c with the given limit, without waiting for it
+void request_julia_preview(JuliaPreview* preview, Complex c, int max_iterations);
+// Colors a finished preview into frame.texture, returns whether there is one to show
+int update_julia_preview(JuliaPreview* preview);
+void destroy_julia_preview(JuliaPreview* preview);
+
+#endif
@@ -0,0 +1,140 @@
+#include "kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int always_supported(void) {
+    return 1;
+}
+
+#if SIMD_KERNELS_AVAILABLE
+static int has_sse2(void) {
+    return SDL_HasSSE2();
+}
+
+static int has_avx(void) {
+    return SDL_HasAVX();
+}
+
+// SDL has no FMA query, every AVX2 part we ship to has it but check anyway
+static int has_avx2_fma(void) {
+    return SDL_HasAVX2() && __builtin_cpu_supports("fma");
+}
+
+static int has_avx512(void) {
+    return SDL_HasAVX512F();
+}
+#endif
+
+// fastest first. Double-double needs FMA to be worth vectorizing, so the
+// ISAs without it share the scalar version and AVX-512 reuses the AVX2 one.
+// Coloring needs gathers, which start with AVX2.
+static const Kernel kernels[] = {
+#if SIMD_KERNELS_AVAILABLE
+    {"avx512", has_avx512, escape_span_avx512, escape_span_dd_avx2, escape_span_float_avx512, color_span_avx512},
+    {"avx2", has_avx2_fma, escape_span_avx2, escape_span_dd_avx2, escape_span_float_avx2, color_span_avx2},
+    {"avx", has_avx, escape_span_avx, escape_span_dd_scalar, escape_span_float_avx, color_span_scalar},
+    {"sse2", has_sse2, escape_span_sse2, escape_span_dd_scalar, escape_span_float_sse2, color_span_scalar},
+#endif
+    {"scalar", always_supported, escape_span_scalar, escape_span_dd_scalar, escape_span_float_scalar,
+     color_span_scalar},
+};
+
+#define KERNEL_COUNT (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static const Kernel* active_kernel = &kernels[KERNEL_COUNT - 1];
+
+static KernelStats stats;
+static SDL_SpinLock stats_lock;
+
+const Kernel* find_kernel(const char* name) {
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            return &kernels[i];
+        }
+    }
+    return NULL;
+}
+
+void print_kernels(void) {
+    fprintf(stderr, "Kernels:");
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        fprintf(stderr, " %s%s", kernels[i].name, kernels[i].is_supported() ? "" : " (unsupported)");
+    }
+    fprintf(stderr, "\n");
+}
+
+void init_kernels(const char* forced_name) {
+    if (!forced_name) {
+        forced_name = getenv("MANDELBROT_KERNEL");
+    }
+    
+    if (forced_name && *forced_name) {
+        const Kernel* kernel = find_kernel(forced_name);
+        if (!kernel) {
+            fprintf(stderr, "Unknown kernel '%s'\n", forced_name);
+            print_kernels();
+        } else if (!kernel->is_supported()) {
+            fprintf(stderr, "Kernel '%s' is not supported by this CPU\n", forced_name);
+        } else {
+            active_kernel = kernel;
+            fprintf(stderr, "Using %s kernel (forced)\n", active_kernel->name);
+            return;
+        }
+    }
+    
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        if (kernels[i].is_supported()) {
+            active_kernel = &kernels[i];
+            break;
+        }
+    }
+    fprintf(stderr, "Using %s kernel\n", active_kernel->name);
+}
+
+void add_kernel_stats(int points, int cardioid_skips) {
+    SDL_AtomicLock(&stats_lock);
+    stats.points += points;
+    stats.cardioid_skips += cardioid_skips;
+    SDL_AtomicUnlock(&stats_lock);
+}
+
+void add_kernel_iterations(Uint64 iterations) {
+    SDL_AtomicLock(&stats_lock);
+    stats.iterations += iterations;
+    SDL_AtomicUnlock(&stats_lock);
+}
+
+KernelStats get_kernel_stats(void) {
+    SDL_AtomicLock(&stats_lock);
+    KernelStats copy = stats;
+    SDL_AtomicUnlock(&stats_lock);
+    return copy;
+}
+
+void reset_kernel_stats(void) {
+    SDL_AtomicLock(&stats_lock);
+    stats.points = 0;
+    stats.cardioid_skips = 0;
+    stats.iterations = 0;
+    SDL_AtomicUnlock(&stats_lock);
+}
+
+const Kernel* get_active_kernel(void) {
+    return active_kernel;
+}
+
+int escape_span(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                int max_iterations) {
+    return active_kernel->escape_span(out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+}
+
+int escape_span_dd(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                   Complex step, int is_julia, Complex julia_c, int max_iterations) {
+    return active_kernel->escape_span_dd(out, first, stride, count, origin, origin_low, step, is_julia, julia_c, max_iterations);
+}
+
+int escape_span_float(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                      int max_iterations) {
+    return active_kernel->escape_span_float(out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+}
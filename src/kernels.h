@@ -0,0 +1,95 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "mandelbrot.h"
+#include "coloring.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNELS_AVAILABLE 1
+#else
+#define SIMD_KERNELS_AVAILABLE 0
+#endif
+
+typedef int (*EscapeSpanFunc)(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                               int max_iterations);
+
+typedef int (*EscapeSpanDDFunc)(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                                 Complex step, int is_julia, Complex julia_c, int max_iterations);
+
+// Colors count escape values through table, see lookup_color()
+typedef void (*ColorSpanFunc)(const int* values, Uint32* pixels, int count, float scale, const ColorTable* table);
+
+typedef struct {
+    const char* name;
+    int (*is_supported)(void);
+    EscapeSpanFunc escape_span;
+    EscapeSpanDDFunc escape_span_dd;
+    EscapeSpanFunc escape_span_float;
+    ColorSpanFunc color_span;
+} Kernel;
+
+typedef struct {
+    Uint64 points;          // points handed to escape_span()
+    Uint64 cardioid_skips;  // of those, answered by in_main_cardioid_or_bulb()
+    Uint64 iterations;      // escape counts of the points compute_span() was asked for
+} KernelStats;
+
+// Binds escape_span() to the fastest kernel this CPU supports. forced_name
+// (or the MANDELBROT_KERNEL environment variable when it is NULL) selects a
+// specific kernel instead, for A/B comparisons.
+void init_kernels(const char* forced_name);
+const Kernel* get_active_kernel(void);
+const Kernel* find_kernel(const char* name);
+void print_kernels(void);
+
+// Counters are summed over all threads until the next reset. The kernels
+// only return their cardioid skips and compute_span() reports a span's work,
+// unless its grid is untracked, so a background computation like the Julia
+// preview does not show up in the main frame's numbers.
+void add_kernel_stats(int points, int cardioid_skips);
+void add_kernel_iterations(Uint64 iterations);
+KernelStats get_kernel_stats(void);
+void reset_kernel_stats(void);
+
+int escape_span_scalar(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                       int max_iterations);
+// Copies of a span kernel with the iteration limit as a constant, for the
+// limits choose_iteration_limit() starts out with. SPAN(limit) is expanded
+// once per copy.
+#define SPECIALIZE_ITERATION_LIMIT(max_iterations, SPAN) \
+    switch (max_iterations) { \
+        case DEFAULT_ITERATIONS: SPAN(DEFAULT_ITERATIONS); break; \
+        case DEFAULT_ITERATIONS * 2: SPAN(DEFAULT_ITERATIONS * 2); break; \
+        case DEFAULT_ITERATIONS * 4: SPAN(DEFAULT_ITERATIONS * 4); break; \
+        case DEFAULT_ITERATIONS * 8: SPAN(DEFAULT_ITERATIONS * 8); break; \
+        default: SPAN(max_iterations); break; \
+    }
+
+int escape_span_dd_scalar(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                          Complex step, int is_julia, Complex julia_c, int max_iterations);
+int escape_span_float_scalar(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                             int max_iterations);
+#if SIMD_KERNELS_AVAILABLE
+int escape_span_sse2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                     int max_iterations);
+int escape_span_avx(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                    int max_iterations);
+int escape_span_avx2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                     int max_iterations);
+int escape_span_avx512(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                       int max_iterations);
+int escape_span_dd_avx2(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                        Complex step, int is_julia, Complex julia_c, int max_iterations);
+int escape_span_float_sse2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                           int max_iterations);
+int escape_span_float_avx(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                          int max_iterations);
+int escape_span_float_avx2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                           int max_iterations);
+int escape_span_float_avx512(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                             int max_iterations);
+void color_span_avx2(const int* values, Uint32* pixels, int count, float scale, const ColorTable* table);
+void color_span_avx512(const int* values, Uint32* pixels, int count, float scale, const ColorTable* table);
+#endif
+
+#endif
@@ -1,170 +1,981 @@
-#include <complex.h>
-#include <SDL.h>
-#include <stdio.h>
-#include <math.h>
-#include "mouse_handler.h"
-#include "ui.h"
-
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
-#define MAX_ITERATIONS 150
-
-int mandelbrot(Complex c) {
-    Complex z = {0.0, 0.0};
-    int i;
-    
-    for (i = 0; i < MAX_ITERATIONS; i++) {
-        // z = z * z + c
-        double temp_real = z.real * z.real - z.imag * z.imag + c.real;
-        double temp_imag = 2 * z.real * z.imag + c.imag;
-        z.real = temp_real;
-        z.imag = temp_imag;
-        
-        double abs_z = hypot(z.real, z.imag);
-        if (abs_z > 2)
-            return i;
-    }
-    return MAX_ITERATIONS;
-}
-
-int julia(Complex z, Complex c) {
-    int i;
-    for (i = 0; i < MAX_ITERATIONS; i++) {
-        // z = z * z + c
-        double temp_real = z.real * z.real - z.imag * z.imag + c.real;
-        double temp_imag = 2 * z.real * z.imag + c.imag;
-        z.real = temp_real;
-        z.imag = temp_imag;
-        
-        double abs_z = hypot(z.real, z.imag);
-        if (abs_z > 2)
-            return i;
-    }
-    return MAX_ITERATIONS;
-}
-
-void render(SDL_Renderer* renderer, ViewPort view, int is_julia, Complex julia_c) {
-    
-    SDL_SetRenderDrawColor(renderer, 0, 0, 50, 255);
-    SDL_RenderClear(renderer);
-    
-    for (int x = 0; x < WINDOW_WIDTH; x++) {
-        for (int y = 0; y < WINDOW_HEIGHT; y++) {
-            double real = view.x_min + (x * (view.x_max - view.x_min)) / WINDOW_WIDTH;
-            double imag = view.y_min + (y * (view.y_max - view.y_min)) / WINDOW_HEIGHT;
-            Complex c = {real, imag};
-            
-            int iterations;
-            if (is_julia)
-                iterations = julia(c, julia_c);
-            else
-                iterations = mandelbrot(c);
-            
-            if (iterations == MAX_ITERATIONS) {
-                
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            } else {
-                
-                double t = (double)iterations / MAX_ITERATIONS;
-                t = 0.5 + 0.5 * cos(log(t + 0.0001) * 3.0);
-                
-                
-                int r = (int)(255 * t * 0.2);  
-                int g = (int)(255 * t * 0.4);  
-                int b = (int)(255 * t);        
-                
-                SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-            }
-            SDL_RenderDrawPoint(renderer, x, y);
-        }
-    }
-}
-
-int main(int argc, char *argv[]) {
-    SDL_Window* window = NULL;
-    SDL_Renderer* renderer = NULL;
-    
-    SDL_Init(SDL_INIT_VIDEO);
-    window = SDL_CreateWindow("Mandelbrot/Julia Explorer", 
-                            SDL_WINDOWPOS_UNDEFINED, 
-                            SDL_WINDOWPOS_UNDEFINED, 
-                            WINDOW_WIDTH, WINDOW_HEIGHT, 
-                            SDL_WINDOW_SHOWN);
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    
-    ViewPort view = {
-        .x_min = -2.0,
-        .x_max = 1.0,
-        .y_min = -1.5,
-        .y_max = 1.5,
-        .zoom = 1.0
-    };
-    
-    MouseState mouse = {
-        .is_dragging = 0,
-        .start_x = 0,
-        .start_y = 0
-    };
-    
-    int quit = 0;
-    int is_julia = 0;
-    Complex julia_c = {0, 0};
-    
-    const int FPS = 60;
-    const int FRAME_DELAY = 1000 / FPS;
-    Uint32 frame_start;
-    int frame_time;
-    
-    UI ui;
-    init_ui(&ui, renderer);
-    
-    while (!quit) {
-        frame_start = SDL_GetTicks();
-        
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-
-            if (handle_ui_event(&ui, event, &view)) {
-                continue;
-            }
-            
-            switch (event.type) {
-                case SDL_QUIT:
-                    quit = 1;
-                    break;
-                case SDL_KEYDOWN:
-                    if (event.key.keysym.sym == SDLK_SPACE)
-                        is_julia = !is_julia;
-                    break;
-                default:
-                    handle_mouse(event, &mouse, &view);
-                    break;
-            }
-            
-            if (!mouse.is_dragging) {
-                int x, y;
-                SDL_GetMouseState(&x, &y);
-                julia_c = get_complex_from_mouse(x, y, view, WINDOW_WIDTH, WINDOW_HEIGHT);
-            }
-        }
-        
-        SDL_SetRenderDrawColor(renderer, 0, 0, 50, 255);  
-        SDL_RenderClear(renderer);
-        
-        render(renderer, view, is_julia, julia_c);
-        render_ui(&ui, renderer, view, julia_c, is_julia);
-        SDL_RenderPresent(renderer);  
-        
-        frame_time = SDL_GetTicks() - frame_start;
-        if (frame_time < FRAME_DELAY) {
-            SDL_Delay(FRAME_DELAY - frame_time);
-        }
-    }
-    
-    cleanup_ui(&ui);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-    
-    return 0;
-} 
+#include <complex.h>
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "mandelbrot.h"
+#include "kernels.h"
+#include "double_double.h"
+#include "headless.h"
+#include "bench.h"
+#include "coloring.h"
+#include "mariani_silver.h"
+#include "perturbation.h"
+#include "progressive.h"
+#include "tile_cache.h"
+#include "tile_store.h"
+#include "ui.h"
+
+// Inlined into every caller so the hot-limit copies below get a constant bound
+static inline __attribute__((always_inline)) int escape_time(Complex z, Complex c, int max_iterations) {
+    // Brent-style cycle detection: remember z at power-of-two iteration counts
+    // and stop once the orbit comes back to it, it is periodic and never escapes
+    Complex saved = z;
+    int next_save = 1;
+    int i;
+    
+    for (i = 0; i < max_iterations; i++) {
+        // z = z * z + c
+        double temp_real = z.real * z.real - z.imag * z.imag + c.real;
+        double temp_imag = 2 * z.real * z.imag + c.imag;
+        z.real = temp_real;
+        z.imag = temp_imag;
+        
+        // |z| > 2 without the square root
+        double magnitude = z.real * z.real + z.imag * z.imag;
+        if (magnitude > 4)
+            return escaped_value(i, magnitude);
+        
+        if (fabs(z.real - saved.real) < PERIODICITY_EPSILON &&
+            fabs(z.imag - saved.imag) < PERIODICITY_EPSILON)
+            return interior_escape_value(max_iterations);
+        
+        if (i + 1 == next_save) {
+            saved = z;
+            next_save *= 2;
+        }
+    }
+    return interior_escape_value(max_iterations);
+}
+
+int mandelbrot(Complex c, int max_iterations) {
+    if (in_main_cardioid_or_bulb(c))
+        return interior_escape_value(max_iterations);
+    
+    Complex z = {0.0, 0.0};
+    return escape_time(z, c, max_iterations);
+}
+
+int julia(Complex z, Complex c, int max_iterations) {
+    return escape_time(z, c, max_iterations);
+}
+
+static inline __attribute__((always_inline)) int scalar_span(int* out, int first, int stride, int count,
+                                                              Complex origin, Complex step, int is_julia,
+                                                              Complex julia_c, int max_iterations) {
+    int skipped = 0;
+    
+    for (int i = 0; i < count; i++) {
+        int index = first + i * stride;
+        Complex point = {origin.real + index * step.real, origin.imag + index * step.imag};
+        
+        if (is_julia) {
+            out[i] = escape_time(point, julia_c, max_iterations);
+        } else if (in_main_cardioid_or_bulb(point)) {
+            out[i] = interior_escape_value(max_iterations);
+            skipped++;
+        } else {
+            Complex z = {0.0, 0.0};
+            out[i] = escape_time(z, point, max_iterations);
+        }
+    }
+    return skipped;
+}
+
+int escape_span_scalar(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                       int max_iterations) {
+    int skipped;
+#define SCALAR_SPAN(limit) skipped = scalar_span(out, first, stride, count, origin, step, is_julia, julia_c, limit)
+    SPECIALIZE_ITERATION_LIMIT(max_iterations, SCALAR_SPAN);
+#undef SCALAR_SPAN
+    return skipped;
+}
+
+static inline __attribute__((always_inline)) int escape_time_float(float zr, float zi, float cr, float ci,
+                                                                   int max_iterations) {
+    float saved_r = zr, saved_i = zi;
+    int next_save = 1;
+    int i;
+    
+    for (i = 0; i < max_iterations; i++) {
+        // z = z * z + c
+        float temp_real = zr * zr - zi * zi + cr;
+        zi = 2 * zr * zi + ci;
+        zr = temp_real;
+        
+        float magnitude = zr * zr + zi * zi;
+        if (magnitude > 4)
+            return escaped_value(i, magnitude);
+        
+        if (fabsf(zr - saved_r) < FLOAT_PERIODICITY_EPSILON &&
+            fabsf(zi - saved_i) < FLOAT_PERIODICITY_EPSILON)
+            return interior_escape_value(max_iterations);
+        
+        if (i + 1 == next_save) {
+            saved_r = zr;
+            saved_i = zi;
+            next_save *= 2;
+        }
+    }
+    return interior_escape_value(max_iterations);
+}
+
+static inline __attribute__((always_inline)) int scalar_float_span(int* out, int first, int stride, int count,
+                                                                    Complex origin, Complex step, int is_julia,
+                                                                    Complex julia_c, int max_iterations) {
+    int skipped = 0;
+    
+    for (int i = 0; i < count; i++) {
+        int index = first + i * stride;
+        Complex point = {origin.real + index * step.real, origin.imag + index * step.imag};
+        
+        if (is_julia) {
+            out[i] = escape_time_float((float)point.real, (float)point.imag, (float)julia_c.real, (float)julia_c.imag,
+                                       max_iterations);
+        } else if (in_main_cardioid_or_bulb(point)) {
+            out[i] = interior_escape_value(max_iterations);
+            skipped++;
+        } else {
+            out[i] = escape_time_float(0.0f, 0.0f, (float)point.real, (float)point.imag, max_iterations);
+        }
+    }
+    return skipped;
+}
+
+int escape_span_float_scalar(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia,
+                             Complex julia_c, int max_iterations) {
+    int skipped;
+#define SCALAR_FLOAT_SPAN(limit) skipped = scalar_float_span(out, first, stride, count, origin, step, is_julia, julia_c, limit)
+    SPECIALIZE_ITERATION_LIMIT(max_iterations, SCALAR_FLOAT_SPAN);
+#undef SCALAR_FLOAT_SPAN
+    return skipped;
+}
+
+int init_frame_buffer(FrameBuffer* fb, SDL_Renderer* renderer, int width, int height) {
+    fb->width = width;
+    fb->height = height;
+    fb->pixels = malloc(sizeof(Uint32) * width * height);
+    fb->iterations = malloc(sizeof(int) * width * height);
+    fb->texture = NULL;
+    fb->upload_ticks = 0;
+    if (renderer) {
+        fb->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                        SDL_TEXTUREACCESS_STREAMING, width, height);
+    }
+    if (!fb->pixels || !fb->iterations || (renderer && !fb->texture)) {
+        printf("Frame buffer could not be created: %s\n", SDL_GetError());
+        destroy_frame_buffer(fb);
+        return 0;
+    }
+    return 1;
+}
+
+void upload_frame_buffer(FrameBuffer* fb) {
+    void* texture_pixels;
+    int pitch;
+    
+    if (!fb->texture) {
+        return;
+    }
+    
+    Uint64 start = SDL_GetPerformanceCounter();
+    // one lock/copy/unlock per frame instead of a renderer call per pixel
+    if (SDL_LockTexture(fb->texture, NULL, &texture_pixels, &pitch) != 0) {
+        SDL_UpdateTexture(fb->texture, NULL, fb->pixels, fb->width * sizeof(Uint32));
+    } else {
+        for (int y = 0; y < fb->height; y++) {
+            memcpy((Uint8*)texture_pixels + y * pitch, fb->pixels + y * fb->width,
+                   fb->width * sizeof(Uint32));
+        }
+        SDL_UnlockTexture(fb->texture);
+    }
+    fb->upload_ticks += SDL_GetPerformanceCounter() - start;
+}
+
+void destroy_frame_buffer(FrameBuffer* fb) {
+    if (fb->texture) {
+        SDL_DestroyTexture(fb->texture);
+        fb->texture = NULL;
+    }
+    free(fb->pixels);
+    fb->pixels = NULL;
+    free(fb->iterations);
+    fb->iterations = NULL;
+}
+
+Precision choose_precision(ViewPort view, int width, int height, int max_iterations) {
+    double view_width = get_view_width(view);
+    double view_height = get_view_height(view);
+    double spacing = fmin(view_width / width, view_height / height);
+    double magnitude = fmax(fabs(fixed_to_double(&view.center_real)),
+                            fabs(fixed_to_double(&view.center_imag))) + fmax(view_width, view_height) / 2;
+    
+    double float_spacing = FLOAT_SPACING * SDL_max(max_iterations, DEFAULT_ITERATIONS) / DEFAULT_ITERATIONS;
+    
+    if (spacing >= float_spacing * magnitude && max_iterations <= FLOAT_MAX_ITERATIONS) {
+        return PRECISION_FLOAT;
+    }
+    if (spacing >= DOUBLE_SPACING * magnitude) {
+        return PRECISION_DOUBLE;
+    }
+    if (spacing >= DOUBLE_DOUBLE_SPACING * magnitude) {
+        return PRECISION_DOUBLE_DOUBLE;
+    }
+    return PRECISION_PERTURBATION;
+}
+
+const char* precision_name(Precision precision) {
+    switch (precision) {
+        case PRECISION_FLOAT: return "float";
+        case PRECISION_DOUBLE: return "double";
+        case PRECISION_DOUBLE_DOUBLE: return "double-double";
+        case PRECISION_PERTURBATION: return "perturbation";
+    }
+    return "unknown";
+}
+
+int choose_iteration_limit(ViewPort view, int fixed_limit) {
+    if (fixed_limit > 0) {
+        return SDL_min(fixed_limit, MAX_ITERATION_LIMIT);
+    }
+    
+    // the largest doubling of the default that the zoom depth asks for
+    double wanted = DEFAULT_ITERATIONS + ITERATIONS_PER_OCTAVE * log2(fmax(view.zoom, 1.0));
+    int limit = DEFAULT_ITERATIONS;
+    while (limit * 2 <= wanted && limit * 2 <= MAX_ITERATION_LIMIT) {
+        limit *= 2;
+    }
+    return limit;
+}
+
+// value rounded to a double in *hi, and the rounding error in *lo
+static void split_fixed(const Fixed* value, double* hi, double* lo) {
+    Fixed rounded;
+    *hi = fixed_to_double(value);
+    fixed_from_double(&rounded, *hi);
+    *lo = fixed_difference(value, &rounded);
+}
+
+PixelGrid make_pixel_grid(ViewPort view, int width, int height, int is_julia, Complex julia_c, int max_iterations) {
+    double view_width = get_view_width(view);
+    double view_height = get_view_height(view);
+    PixelGrid grid = {
+        .step_x = view_width / width,
+        .step_y = view_height / height,
+        .is_julia = is_julia,
+        .julia_c = julia_c,
+        .precision = PRECISION_DOUBLE,
+        .max_iterations = max_iterations
+    };
+    
+    Fixed left, top;
+    fixed_add_double(&left, &view.center_real, -view_width / 2);
+    fixed_add_double(&top, &view.center_imag, -view_height / 2);
+    split_fixed(&left, &grid.origin.real, &grid.origin_low.real);
+    split_fixed(&top, &grid.origin.imag, &grid.origin_low.imag);
+    return grid;
+}
+
+Complex grid_origin_shift(const PixelGrid* previous, const PixelGrid* grid) {
+    // nearby origins subtract exactly, the low parts then add what they lost
+    Complex frame = grid_frame_offset(previous, grid);
+    Complex shift = {
+        (grid->origin.real - previous->origin.real) + (grid->origin_low.real - previous->origin_low.real) + frame.real,
+        (grid->origin.imag - previous->origin.imag) + (grid->origin_low.imag - previous->origin_low.imag) + frame.imag
+    };
+    return shift;
+}
+
+void compute_span(const PixelGrid* grid, int* out, int x, int y, int dx, int dy, int count) {
+    Complex origin = grid->origin;
+    Complex origin_low = grid->origin_low;
+    Complex step = {0.0, 0.0};
+    int first, stride;
+    
+    // move the origin onto the fixed row or column, keeping the rounding
+    // error of that move for double-double
+    if (dy == 0) {
+        DoubleDouble imag = two_sum(origin.imag, y * grid->step_y);
+        origin.imag = imag.hi;
+        origin_low.imag += imag.lo;
+        step.real = grid->step_x;
+        first = x;
+        stride = dx;
+    } else {
+        DoubleDouble real = two_sum(origin.real, x * grid->step_x);
+        origin.real = real.hi;
+        origin_low.real += real.lo;
+        step.imag = grid->step_y;
+        first = y;
+        stride = dy;
+    }
+    
+    int skipped = 0;
+    switch (grid->precision) {
+        case PRECISION_FLOAT:
+            skipped = escape_span_float(out, first, stride, count, origin, step, grid->is_julia, grid->julia_c,
+                                        grid->max_iterations);
+            break;
+        case PRECISION_DOUBLE_DOUBLE:
+            skipped = escape_span_dd(out, first, stride, count, origin, origin_low, step, grid->is_julia,
+                                     grid->julia_c, grid->max_iterations);
+            break;
+        case PRECISION_PERTURBATION:
+            perturbation_span(out, first, stride, count, origin, step, grid->reference);
+            break;
+        default:
+            skipped = escape_span(out, first, stride, count, origin, step, grid->is_julia, grid->julia_c,
+                                  grid->max_iterations);
+            break;
+    }
+    if (grid->untracked) {
+        return;
+    }
+    
+    // glitched pixels are counted once repair_glitches() has redone them
+    Uint64 iterations = 0;
+    for (int i = 0; i < count; i++) {
+        iterations += escape_count(SDL_max(out[i], 0));
+    }
+    add_kernel_stats(count, skipped);
+    add_kernel_iterations(iterations);
+}
+
+void compute_row(const PixelGrid* grid, int* out, int y, int x0, int x1) {
+    compute_span(grid, out, x0, y, 1, 0, x1 - x0);
+}
+
+void compute_column(const PixelGrid* grid, int* out, int stride, int x, int y0, int y1) {
+    int column[TILE_SIZE];
+    
+    for (int y = y0; y < y1; y += TILE_SIZE) {
+        int count = SDL_min(TILE_SIZE, y1 - y);
+        compute_span(grid, column, x, y, 0, 1, count);
+        for (int i = 0; i < count; i++) {
+            out[(y - y0 + i) * stride] = column[i];
+        }
+    }
+}
+
+typedef struct {
+    const PixelGrid* grid;
+    RenderStrategy strategy;
+    int* iterations;
+    Uint32* pixels;     // NULL to only compute iterations
+    int width;
+    int height;
+    // region [x0, x1) x [y0, y1) of the frame to render
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+    int tiles_x;
+} RenderJob;
+
+static void render_tile(void* context, int tile) {
+    RenderJob* job = context;
+    
+    int x0 = job->x0 + (tile % job->tiles_x) * TILE_SIZE;
+    int y0 = job->y0 + (tile / job->tiles_x) * TILE_SIZE;
+    int x1 = SDL_min(x0 + TILE_SIZE, job->x1);
+    int y1 = SDL_min(y0 + TILE_SIZE, job->y1);
+    
+    if (job->strategy == RENDER_MARIANI_SILVER) {
+        mariani_silver_tile(job->grid, job->iterations, job->width, x0, y0, x1, y1, 0);
+    } else {
+        for (int y = y0; y < y1; y++) {
+            compute_row(job->grid, job->iterations + y * job->width + x0, y, x0, x1);
+        }
+    }
+    
+    if (!job->pixels) {
+        return;
+    }
+    for (int y = y0; y < y1; y++) {
+        color_span(job->iterations + y * job->width + x0, job->pixels + y * job->width + x0, x1 - x0,
+                   job->grid->max_iterations);
+    }
+}
+
+static void run_render_job(ThreadPool* pool, RenderJob* job, int x0, int y0, int x1, int y1) {
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    job->x0 = x0;
+    job->y0 = y0;
+    job->x1 = x1;
+    job->y1 = y1;
+    job->tiles_x = (x1 - x0 + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (y1 - y0 + TILE_SIZE - 1) / TILE_SIZE;
+    
+    // interior tiles cost up to max_iterations times more than exterior ones,
+    // small tiles plus work stealing keep every core busy until the end
+    run_thread_pool(pool, render_tile, job, job->tiles_x * tiles_y);
+}
+
+void render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* grid, RenderStrategy strategy) {
+    RenderJob job = {
+        .grid = grid,
+        .strategy = strategy,
+        .iterations = fb->iterations,
+        .pixels = fb->pixels,
+        .width = fb->width,
+        .height = fb->height
+    };
+    
+    run_render_job(pool, &job, 0, 0, fb->width, fb->height);
+    repair_glitches(pool, grid, fb->iterations, fb->pixels, fb->width, fb->height);
+    upload_frame_buffer(fb);
+}
+
+// Whole pixel offset (dx, dy) such that pixel (x, y) of grid is pixel
+// (x + dx, y + dy) of previous, or 0 if the grids differ by more than that
+static int grid_offset(const PixelGrid* previous, const PixelGrid* grid, int* dx, int* dy) {
+    const double tolerance = 1e-6;
+    
+    if (grid->precision != previous->precision || grid->reference != previous->reference ||
+        grid->max_iterations != previous->max_iterations || grid->is_julia != previous->is_julia ||
+        (grid->is_julia && (grid->julia_c.real != previous->julia_c.real ||
+                            grid->julia_c.imag != previous->julia_c.imag))) {
+        return 0;
+    }
+    if (fabs(grid->step_x - previous->step_x) > tolerance * fabs(previous->step_x) ||
+        fabs(grid->step_y - previous->step_y) > tolerance * fabs(previous->step_y)) {
+        return 0;
+    }
+    
+    Complex shift = grid_origin_shift(previous, grid);
+    double offset_x = shift.real / previous->step_x;
+    double offset_y = shift.imag / previous->step_y;
+    if (fabs(offset_x) > INT_MAX / 2 || fabs(offset_y) > INT_MAX / 2 ||
+        fabs(offset_x - round(offset_x)) > tolerance ||
+        fabs(offset_y - round(offset_y)) > tolerance) {
+        return 0;
+    }
+    *dx = (int)round(offset_x);
+    *dy = (int)round(offset_y);
+    return 1;
+}
+
+// Moves a width x height plane of 4 byte values so that (x, y) takes the
+// value of (x + dx, y + dy). Values without a source are left as they were.
+static void shift_plane(void* data, int width, int height, int dx, int dy) {
+    Uint32* plane = data;
+    int count = width - abs(dx);
+    int to_x = dx < 0 ? -dx : 0;
+    int from_x = dx > 0 ? dx : 0;
+    
+    // walk rows against the direction of the move so no source row is overwritten early
+    for (int i = 0; i < height - abs(dy); i++) {
+        int y = dy > 0 ? i : height - 1 - i;
+        memmove(plane + y * width + to_x, plane + (y + dy) * width + from_x, count * sizeof(Uint32));
+    }
+}
+
+int scroll_render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* previous, const PixelGrid* grid,
+                  RenderStrategy strategy) {
+    int dx, dy;
+    if (!grid_offset(previous, grid, &dx, &dy) ||
+        abs(dx) >= fb->width || abs(dy) >= fb->height) {
+        return 0;
+    }
+    
+    shift_plane(fb->iterations, fb->width, fb->height, dx, dy);
+    shift_plane(fb->pixels, fb->width, fb->height, dx, dy);
+    
+    RenderJob job = {
+        .grid = grid,
+        .strategy = strategy,
+        .iterations = fb->iterations,
+        .pixels = fb->pixels,
+        .width = fb->width,
+        .height = fb->height
+    };
+    
+    // the exposed columns over the full height, then the exposed rows beside them
+    int columns_x0 = dx > 0 ? fb->width - dx : 0;
+    int columns_x1 = dx > 0 ? fb->width : -dx;
+    int rows_y0 = dy > 0 ? fb->height - dy : 0;
+    int rows_y1 = dy > 0 ? fb->height : -dy;
+    run_render_job(pool, &job, columns_x0, 0, columns_x1, fb->height);
+    run_render_job(pool, &job, dx > 0 ? 0 : -dx, rows_y0, dx > 0 ? fb->width - dx : fb->width, rows_y1);
+    repair_glitches(pool, grid, fb->iterations, fb->pixels, fb->width, fb->height);
+    
+    upload_frame_buffer(fb);
+    return 1;
+}
+
+int validate_render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* grid) {
+    int* reference = malloc(sizeof(int) * fb->width * fb->height);
+    if (!reference) {
+        return -1;
+    }
+    
+    RenderJob job = {
+        .grid = grid,
+        .strategy = RENDER_BRUTE_FORCE,
+        .iterations = reference,
+        .pixels = NULL,
+        .width = fb->width,
+        .height = fb->height
+    };
+    run_render_job(pool, &job, 0, 0, fb->width, fb->height);
+    repair_glitches(pool, grid, reference, NULL, fb->width, fb->height);
+    
+    int mismatches = 0;
+    for (int i = 0; i < fb->width * fb->height; i++) {
+        if (escape_count(reference[i]) != escape_count(fb->iterations[i])) {
+            mismatches++;
+        }
+    }
+    free(reference);
+    return mismatches;
+}
+
+static void print_frame_stats(KernelStats stats, Precision precision) {
+    printf("Last frame: %s, %llu points, %llu (%.1f%%) skipped by the cardioid/bulb test\n",
+           precision_name(precision), (unsigned long long)stats.points, (unsigned long long)stats.cardioid_skips,
+           stats.points ? 100.0 * stats.cardioid_skips / stats.points : 0.0);
+}
+
+static void print_tile_cache_stats(const TileCache* cache) {
+    TileCacheStats stats = get_tile_cache_stats(cache);
+    printf("Tile cache: %d tiles, %.1f of %.1f MB, %llu hits, %llu misses, %llu evictions\n",
+           stats.tiles, stats.bytes / (1024.0 * 1024.0), stats.memory_limit / (1024.0 * 1024.0),
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+}
+
+static void print_tile_store_stats(const TileStore* store) {
+    TileStoreStats stats = get_tile_store_stats(store);
+    printf("Tile store: %d of %d slots used%s, %llu tiles loaded, %llu missing, %llu saved\n",
+           stats.used_slots, stats.slots, stats.read_only ? " (read-only)" : "",
+           (unsigned long long)stats.loads, (unsigned long long)stats.misses, (unsigned long long)stats.saves);
+}
+
+static int view_equals(ViewPort a, ViewPort b) {
+    return fixed_equals(&a.center_real, &b.center_real) &&
+           fixed_equals(&a.center_imag, &b.center_imag) &&
+           a.width == b.width && a.height == b.height &&
+           a.scale_exponent == b.scale_exponent && a.zoom == b.zoom;
+}
+
+static int complex_equals(Complex a, Complex b) {
+    return a.real == b.real && a.imag == b.imag;
+}
+
+int main(int argc, char *argv[]) {
+    SDL_Window* window = NULL;
+    SDL_Renderer* renderer = NULL;
+    
+    const char* kernel_name = NULL;
+    RenderStrategy strategy = RENDER_BRUTE_FORCE;
+    int validate = 0;
+    int fixed_limit = 0;    // 0 lets choose_iteration_limit() follow the zoom
+    int headless = 0;
+    int bench = 0;
+    int tile_cache_mb = DEFAULT_TILE_CACHE_MB;
+    const char* tile_store_path = NULL;     // NULL picks the default in the user's pref path
+    int tile_store_mb = DEFAULT_TILE_STORE_MB;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            kernel_name = argv[++i];
+        } else if (strcmp(argv[i], "--mariani-silver") == 0) {
+            strategy = RENDER_MARIANI_SILVER;
+        } else if (strcmp(argv[i], "--validate") == 0) {
+            validate = 1;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            // a number fixes the limit, "auto" keeps the default
+            fixed_limit = atoi(argv[++i]);
+            fixed_limit = SDL_max(fixed_limit, 0);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(argv[i], "--tile-cache") == 0 && i + 1 < argc) {
+            // megabytes, 0 turns the cache off
+            tile_cache_mb = SDL_max(atoi(argv[++i]), 0);
+        } else if (strcmp(argv[i], "--tile-store") == 0 && i + 1 < argc) {
+            // a file path, "none" turns the store off
+            tile_store_path = argv[++i];
+        } else if (strcmp(argv[i], "--tile-store-mb") == 0 && i + 1 < argc) {
+            tile_store_mb = SDL_max(atoi(argv[++i]), 1);
+        }
+    }
+    
+    init_coloring();
+    
+    // no window, see headless.h for the options
+    if (headless) {
+        init_kernels(kernel_name);
+        return run_headless(argc, argv, strategy, fixed_limit);
+    }
+    if (bench) {
+        init_kernels(kernel_name);
+        return run_bench(argc, argv, strategy, fixed_limit);
+    }
+    
+    SDL_Init(SDL_INIT_VIDEO);
+    init_kernels(kernel_name);
+    window = SDL_CreateWindow("Mandelbrot/Julia Explorer", 
+                            SDL_WINDOWPOS_UNDEFINED, 
+                            SDL_WINDOWPOS_UNDEFINED, 
+                            WINDOW_WIDTH, WINDOW_HEIGHT, 
+                            SDL_WINDOW_SHOWN);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    
+    ViewPort view = make_view(-0.5, 0.0, HOME_WIDTH, HOME_WIDTH);
+    
+    MouseState mouse = {
+        .is_dragging = 0,
+        .start_x = 0,
+        .start_y = 0
+    };
+    
+    int quit = 0;
+    int is_julia = 0;
+    Complex julia_c = {0, 0};
+    
+    const int FPS = 60;
+    const int FRAME_DELAY = 1000 / FPS;
+    const int IDLE_WAIT_MS = 500;
+    // time a frame may spend refining the image before events are handled again
+    const double RENDER_BUDGET_MS = 12.0;
+    // one trip through the palette while color cycling is on
+    const double COLOR_CYCLE_MS = 8000.0;
+    const double BRIGHTNESS_STEP = 1.1;
+    Uint32 frame_start;
+    int frame_time;
+    
+    FrameBuffer frame = {0};
+    if (!init_frame_buffer(&frame, renderer, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+    
+    ThreadPool* pool = create_thread_pool(0);
+    if (!pool) {
+        printf("Thread pool could not be created\n");
+        destroy_frame_buffer(&frame);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+    
+    // composed frames are sampled from the lattice rather than computed per
+    // pixel, so there would be nothing to compare against brute force
+    if (validate && tile_cache_mb > 0) {
+        printf("Validating, rendering without the tile cache\n");
+        tile_cache_mb = 0;
+    }
+    
+    TileCache* tile_cache = NULL;
+    if (tile_cache_mb > 0) {
+        tile_cache = create_tile_cache((size_t)tile_cache_mb * 1024 * 1024);
+        if (!tile_cache) {
+            printf("Tile cache could not be created, rendering without it\n");
+        }
+    }
+    
+    // tiles of earlier runs, so the home view and places visited before
+    // come up without being computed again
+    TileStore* tile_store = NULL;
+    if (tile_cache && (!tile_store_path || strcmp(tile_store_path, "none") != 0)) {
+        char* pref_path = tile_store_path ? NULL : SDL_GetPrefPath("", "mandelbrot-explorer");
+        char* default_path = NULL;
+        if (pref_path) {
+            size_t length = strlen(pref_path) + strlen(TILE_STORE_FILE) + 1;
+            default_path = malloc(length);
+            if (default_path) {
+                snprintf(default_path, length, "%s%s", pref_path, TILE_STORE_FILE);
+            }
+            SDL_free(pref_path);
+        }
+        const char* path = tile_store_path ? tile_store_path : default_path;
+        if (path) {
+            tile_store = open_tile_store(path, tile_store_mb);
+        }
+        if (tile_store) {
+            set_tile_cache_store(tile_cache, tile_store);
+            TileStoreStats stats = get_tile_store_stats(tile_store);
+            printf("Tile store: %s, %d tiles%s\n", path, stats.used_slots, stats.read_only ? ", read-only" : "");
+        }
+        free(default_path);
+    }
+    
+    UI ui;
+    init_ui(&ui, renderer);
+    
+    // state the cached frame in frame.texture was rendered with
+    int frame_valid = 0;
+    ViewPort rendered_view = view;
+    int rendered_is_julia = is_julia;
+    RenderStrategy rendered_strategy = strategy;
+    Complex rendered_julia_c = julia_c;
+    Complex presented_julia_c = julia_c;
+    KernelStats frame_stats = {0};
+    PixelGrid rendered_grid = {0};
+    ReferenceOrbit* reference = NULL;
+    ProgressiveRender progress;
+    // finished frames fill the tile cache, composed ones only hold what it had
+    int cache_frame = 0;
+    int frame_composed = 0;
+    int refining = 0;
+    int needs_present = 1;
+    // what the frame being built has cost so far, for the timing HUD
+    FrameSample sample = {0};
+    Uint64 last_present = 0;
+    // color settings frame.pixels were colored with, see coloring.h
+    Uint32 colored_generation = get_color_generation();
+    int cycling = 0;
+    Uint32 last_cycle = 0;
+    
+    while (!quit) {
+        SDL_Event event;
+        
+        // block while nothing is pending so an idle explorer uses no CPU
+        int has_event = needs_present || cycling ? SDL_PollEvent(&event)
+                                                 : SDL_WaitEventTimeout(&event, IDLE_WAIT_MS);
+        frame_start = SDL_GetTicks();
+        
+        for (; has_event; has_event = SDL_PollEvent(&event)) {
+            
+            if (handle_ui_event(&ui, event, &view)) {
+                needs_present = 1;
+                continue;
+            }
+            
+            switch (event.type) {
+                case SDL_QUIT:
+                    quit = 1;
+                    break;
+                case SDL_KEYDOWN:
+                    if (event.key.keysym.sym == SDLK_SPACE)
+                        is_julia = !is_julia;
+                    else if (event.key.keysym.sym == SDLK_i) {
+                        if (frame_valid)
+                            print_frame_stats(frame_stats, rendered_grid.precision);
+                        if (tile_cache)
+                            print_tile_cache_stats(tile_cache);
+                        if (tile_store)
+                            print_tile_store_stats(tile_store);
+                    }
+                    else if (event.key.keysym.sym == SDLK_m)
+                        strategy = strategy == RENDER_MARIANI_SILVER ? RENDER_BRUTE_FORCE
+                                                                     : RENDER_MARIANI_SILVER;
+                    else if (event.key.keysym.sym == SDLK_RIGHTBRACKET)
+                        fixed_limit = SDL_min(choose_iteration_limit(view, fixed_limit) * 2, MAX_ITERATION_LIMIT);
+                    else if (event.key.keysym.sym == SDLK_LEFTBRACKET)
+                        fixed_limit = SDL_max(choose_iteration_limit(view, fixed_limit) / 2, 1);
+                    else if (event.key.keysym.sym == SDLK_a)
+                        fixed_limit = 0;
+                    else if (event.key.keysym.sym == SDLK_p) {
+                        ColorSettings colors = get_color_settings();
+                        colors.palette = (colors.palette + 1) % get_palette_count();
+                        set_color_settings(&colors);
+                        printf("Palette: %s\n", get_palette(colors.palette)->name);
+                    }
+                    else if (event.key.keysym.sym == SDLK_c) {
+                        cycling = !cycling;
+                        last_cycle = SDL_GetTicks();
+                    }
+                    else if (event.key.keysym.sym == SDLK_EQUALS || event.key.keysym.sym == SDLK_MINUS) {
+                        ColorSettings colors = get_color_settings();
+                        colors.brightness *= event.key.keysym.sym == SDLK_EQUALS ? BRIGHTNESS_STEP : 1.0 / BRIGHTNESS_STEP;
+                        set_color_settings(&colors);
+                    }
+                    break;
+                case SDL_WINDOWEVENT:
+                    needs_present = 1;
+                    break;
+                default:
+                    handle_mouse(event, &mouse, &view);
+                    break;
+            }
+            
+            if (!mouse.is_dragging) {
+                int x, y;
+                SDL_GetMouseState(&x, &y);
+                julia_c = get_complex_from_mouse(x, y, view, WINDOW_WIDTH, WINDOW_HEIGHT);
+            }
+        }
+        
+        Uint64 compute_start = SDL_GetPerformanceCounter();
+        Uint64 uploaded_before = frame.upload_ticks;
+        KernelStats computed_before = get_kernel_stats();
+        
+        if (cycling) {
+            Uint32 now = SDL_GetTicks();
+            ColorSettings colors = get_color_settings();
+            colors.cycle += (now - last_cycle) / COLOR_CYCLE_MS;
+            set_color_settings(&colors);
+            last_cycle = now;
+        }
+        // color changes only recolor the escape values already in the frame;
+        // a frame still being refined is recolored once it is finished
+        if (frame_valid && !refining && colored_generation != get_color_generation()) {
+            color_frame(pool, &frame, rendered_grid.max_iterations);
+            colored_generation = get_color_generation();
+            needs_present = 1;
+        }
+        
+        int max_iterations = choose_iteration_limit(view, fixed_limit);
+        int scene_changed = !frame_valid ||
+                            max_iterations != rendered_grid.max_iterations ||
+                            !view_equals(view, rendered_view) ||
+                            is_julia != rendered_is_julia ||
+                            strategy != rendered_strategy ||
+                            (is_julia && !complex_equals(julia_c, rendered_julia_c));
+        
+        if (scene_changed) {
+            // the cheapest precision that still separates neighbouring pixels;
+            // past double-double pixels are iterated as offsets from a
+            // reference orbit, kept for as long as it stays in view
+            Precision precision = choose_precision(view, frame.width, frame.height, max_iterations);
+            ReferenceOrbit* previous_reference = reference;
+            if (precision != PRECISION_PERTURBATION) {
+                reference = NULL;
+            } else if (!reference_covers(reference, view, is_julia, julia_c, max_iterations)) {
+                reference = create_view_reference(view, is_julia, julia_c, max_iterations);
+            }
+            
+            PixelGrid grid;
+            if (reference) {
+                grid = make_perturbation_grid(view, frame.width, frame.height, reference);
+            } else {
+                // double-double also stands in when the reference orbit could not be allocated
+                grid = make_pixel_grid(view, frame.width, frame.height, is_julia, julia_c, max_iterations);
+                grid.precision = precision == PRECISION_PERTURBATION ? PRECISION_DOUBLE_DOUBLE : precision;
+            }
+            if (!frame_valid || grid.precision != rendered_grid.precision) {
+                printf("Precision: %s\n", precision_name(grid.precision));
+            }
+            if (!frame_valid || grid.max_iterations != rendered_grid.max_iterations) {
+                printf("Iteration limit: %d\n", grid.max_iterations);
+            }
+            
+            // a drag only has to compute the strips it uncovers, a zoom shows
+            // the old frame resampled until its tiles are recomputed
+            reset_kernel_stats();
+            computed_before = (KernelStats){0};
+            // a frame seen before is composed from the tile cache once every
+            // pixel finds its lattice point there; the Julia set of a moving c
+            // would never be seen twice, so it skips the cache
+            int julia_moved = is_julia && rendered_is_julia && !complex_equals(julia_c, rendered_julia_c);
+            cache_frame = tile_cache && !julia_moved;
+            CachedRender cached;
+            int cache_hit = cache_frame && start_cached_render(&cached, tile_cache, &frame, &grid, strategy);
+            if (cache_hit && cached.complete) {
+                compose_cached_render(&cached, pool, &frame);
+                frame_stats = get_kernel_stats();
+                frame_composed = 1;
+                refining = 0;
+            } else if (frame_valid && !refining && !frame_composed && strategy == rendered_strategy &&
+                scroll_render(pool, &frame, &rendered_grid, &grid, strategy)) {
+                frame_stats = get_kernel_stats();
+                if (cache_frame) {
+                    save_cached_tiles(tile_cache, &frame, &grid, strategy);
+                }
+            } else if (frame_valid) {
+                start_reprojected_render(&progress, &frame, &rendered_grid, &grid, strategy);
+                // tiles seen before are a closer stand-in than the resampled frame
+                if (cache_hit && progress.first_pass > 0) {
+                    compose_cached_render(&cached, pool, &frame);
+                }
+                frame_composed = 0;
+                refining = 1;
+            } else {
+                start_progressive_render(&progress, &frame, &grid, strategy);
+                frame_composed = 0;
+                refining = 1;
+            }
+            if (cache_hit) {
+                finish_cached_render(&cached);
+            }
+            if (previous_reference != reference) {
+                destroy_reference_orbit(previous_reference);
+            }
+            needs_present = 1;
+            frame_valid = 1;
+            colored_generation = get_color_generation();
+            rendered_grid = grid;
+            rendered_view = view;
+            rendered_is_julia = is_julia;
+            rendered_strategy = strategy;
+            rendered_julia_c = julia_c;
+        }
+        
+        if (refining) {
+            if (continue_progressive_render(&progress, pool, &frame, RENDER_BUDGET_MS)) {
+                refining = 0;
+                frame_stats = get_kernel_stats();
+                if (cache_frame) {
+                    save_cached_tiles(tile_cache, &frame, &progress.grid, progress.strategy);
+                }
+                if (validate && strategy != RENDER_BRUTE_FORCE) {
+                    int mismatches = validate_render(pool, &frame, &progress.grid);
+                    printf("Validation: %d of %d pixels differ from brute force\n",
+                           mismatches, frame.width * frame.height);
+                }
+            }
+            needs_present = 1;
+        }
+        
+        KernelStats computed = get_kernel_stats();
+        Uint64 uploaded = frame.upload_ticks - uploaded_before;
+        sample.stage_ticks[STAGE_COMPUTE] += SDL_GetPerformanceCounter() - compute_start - uploaded;
+        sample.stage_ticks[STAGE_UPLOAD] += uploaded;
+        sample.points += computed.points - computed_before.points;
+        sample.iterations += computed.iterations - computed_before.iterations;
+        
+        // the julia preview follows the mouse even when the main image does not change
+        if (ui.show_julia_preview && !is_julia && !complex_equals(julia_c, presented_julia_c)) {
+            needs_present = 1;
+        }
+        
+        if (!needs_present) {
+            continue;
+        }
+        
+        Uint64 draw_start = SDL_GetPerformanceCounter();
+        SDL_SetRenderDrawColor(renderer, 0, 0, 50, 255);  
+        SDL_RenderClear(renderer);
+        
+        SDL_RenderCopy(renderer, frame.texture, NULL, NULL);
+        render_ui(&ui, renderer, view, julia_c, is_julia, max_iterations);
+        Uint64 present_start = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(renderer);  
+        Uint64 presented = SDL_GetPerformanceCounter();
+        presented_julia_c = julia_c;
+        needs_present = 0;
+        
+        sample.stage_ticks[STAGE_UI] = present_start - draw_start;
+        sample.stage_ticks[STAGE_PRESENT] = presented - present_start;
+        sample.interval_ticks = last_present ? presented - last_present : 0;
+        record_frame_timing(&ui, &sample);
+        sample = (FrameSample){0};
+        last_present = presented;
+        
+        // while refining the render budget already paces the loop
+        frame_time = SDL_GetTicks() - frame_start;
+        if (!refining && frame_time < FRAME_DELAY) {
+            SDL_Delay(FRAME_DELAY - frame_time);
+        }
+    }
+    
+    cleanup_ui(&ui);
+    destroy_tile_cache(tile_cache);
+    close_tile_store(tile_store);
+    destroy_reference_orbit(reference);
+    destroy_thread_pool(pool);
+    destroy_frame_buffer(&frame);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    
+    return 0;
+} 
@@ -1,9 +1,202 @@
-#ifndef MANDELBROT_H
-#define MANDELBROT_H
-
-#include "mouse_handler.h"
-
-int julia(Complex z, Complex c);
-int mandelbrot(Complex c);
-
-#endif 
\ No newline at end of file
+#ifndef MANDELBROT_H
+#define MANDELBROT_H
+
+#include "mouse_handler.h"
+#include "thread_pool.h"
+
+// Iteration limit of the home view. choose_iteration_limit() adds
+// ITERATIONS_PER_OCTAVE for every doubling of the zoom.
+#define DEFAULT_ITERATIONS 150
+#define ITERATIONS_PER_OCTAVE 32
+// Also keeps counts within the bits escape values leave them, see below
+#define MAX_ITERATION_LIMIT (1 << 20)
+
+// How close an orbit has to come back to a remembered point to count as periodic
+#define PERIODICITY_EPSILON 1e-14
+#define FLOAT_PERIODICITY_EPSILON 1e-6f
+
+// Width of the home view in the complex plane, the zoom is measured against it
+#define HOME_WIDTH 3.0
+
+// render() hands the frame to the thread pool in square tiles of this size
+#define TILE_SIZE 32
+
+typedef enum {
+    RENDER_BRUTE_FORCE,     // every pixel is iterated
+    RENDER_MARIANI_SILVER   // only tile borders, see mariani_silver.h
+} RenderStrategy;
+
+// A precision runs out of bits once the pixel spacing drops below this
+// fraction of the coordinate magnitude, see choose_precision()
+#define FLOAT_SPACING 1e-4
+#define DOUBLE_SPACING 1e-12
+#define DOUBLE_DOUBLE_SPACING 1e-27
+// Float rounding error grows with every iteration: FLOAT_SPACING holds for
+// DEFAULT_ITERATIONS and scales with the limit, and past this limit even
+// coarse views show escaping pixels drawn as interior
+#define FLOAT_MAX_ITERATIONS (DEFAULT_ITERATIONS * 2)
+
+typedef enum {
+    PRECISION_FLOAT,            // single precision, twice the SIMD lanes
+    PRECISION_DOUBLE,
+    PRECISION_DOUBLE_DOUBLE,    // origin + origin_low as a double-double
+    PRECISION_PERTURBATION      // offsets from a reference orbit
+} Precision;
+
+typedef struct ReferenceOrbit ReferenceOrbit;
+
+// Maps pixel (x, y) of a frame to origin + (x * step_x, y * step_y). With a
+// reference that is an offset from the reference point, see perturbation.h.
+typedef struct {
+    Complex origin;
+    Complex origin_low;     // what origin lost to rounding, for double-double
+    double step_x;
+    double step_y;
+    int is_julia;
+    Complex julia_c;
+    Precision precision;
+    int max_iterations;     // escape count of points that never escape
+    const ReferenceOrbit* reference;    // only for PRECISION_PERTURBATION
+    int untracked;          // work on it is kept out of KernelStats, see kernels.h
+} PixelGrid;
+
+// What the kernels write for every pixel: the escape count with a smooth
+// fraction and flags packed below it, so the pixels can be colored again
+// with another palette without iterating. Values of the same count compare
+// equal under escape_count(), and GLITCHED (perturbation.h) stays -1.
+#define ESCAPE_FLAG_BITS 2
+#define ESCAPE_FRACTION_BITS 8
+#define ESCAPE_COUNT_SHIFT (ESCAPE_FLAG_BITS + ESCAPE_FRACTION_BITS)
+#define ESCAPE_FRACTION_STEPS (1 << ESCAPE_FRACTION_BITS)
+
+#define ESCAPE_INTERIOR 1       // never escaped, the count is the iteration limit
+#define ESCAPE_ESTIMATED 2      // filled in from neighbouring pixels instead of iterated
+
+static inline int escape_count(int value) {
+    return value >> ESCAPE_COUNT_SHIFT;
+}
+
+// between 0 and 1 - 1 / ESCAPE_FRACTION_STEPS
+static inline double escape_fraction(int value) {
+    return (double)((value >> ESCAPE_FLAG_BITS) & (ESCAPE_FRACTION_STEPS - 1)) / ESCAPE_FRACTION_STEPS;
+}
+
+static inline int make_escape_value(int count, double fraction, int flags) {
+    int steps = (int)(fraction * ESCAPE_FRACTION_STEPS);
+    steps = SDL_clamp(steps, 0, ESCAPE_FRACTION_STEPS - 1);
+    return (count << ESCAPE_COUNT_SHIFT) | (steps << ESCAPE_FLAG_BITS) | flags;
+}
+
+static inline int interior_escape_value(int max_iterations) {
+    return make_escape_value(max_iterations, 0.0, ESCAPE_INTERIOR);
+}
+
+// log2 of a positive finite x to within 0.0015, enough for an 8-bit fraction
+// at a fraction of the cost of the libm call
+static inline double approx_log2(double x) {
+    union {
+        double value;
+        Uint64 bits;
+    } split = {x};
+    int exponent = (int)((split.bits >> 52) & 0x7FF) - 1023;
+    split.bits = (split.bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    double m = split.value - 1.0;
+    return exponent + m * (1.4234853 + m * (-0.5877338 + m * 0.1655588));
+}
+
+// Escape value of an orbit that first left radius 2 after count iterations
+// with |z|^2 = magnitude. The fraction is the continuous escape time
+// 1 - log2(log2 |z|), which runs from 1 at the radius down towards 0
+// where the next count begins.
+static inline int escaped_value(int count, double magnitude) {
+    return make_escape_value(count, 1.0 - approx_log2(0.5 * approx_log2(magnitude)), 0);
+}
+
+typedef struct {
+    Uint32* pixels;         // packed ARGB8888, width * height
+    int* iterations;        // escape values the pixels were colored from
+    int width;
+    int height;
+    SDL_Texture* texture;   // streaming texture the pixels are uploaded to
+    Uint64 upload_ticks;    // performance counter ticks spent uploading, summed
+} FrameBuffer;
+
+static inline Uint32 pack_argb(int r, int g, int b) {
+    return 0xFF000000u | ((Uint32)r << 16) | ((Uint32)g << 8) | (Uint32)b;
+}
+
+// Closed-form membership test for the main cardioid and the period-2 bulb,
+// the two largest interior regions. Points inside never escape.
+static inline int in_main_cardioid_or_bulb(Complex c) {
+    double x = c.real - 0.25;
+    double y2 = c.imag * c.imag;
+    double q = x * x + y2;
+    if (q * (q + x) <= 0.25 * y2)
+        return 1;
+    
+    double bulb_x = c.real + 1.0;
+    return bulb_x * bulb_x + y2 <= 0.0625;
+}
+
+// Escape values of a single point, see make_escape_value()
+int julia(Complex z, Complex c, int max_iterations);
+int mandelbrot(Complex c, int max_iterations);
+
+// Escape values of the points origin + (first + i * stride) * step for i in
+// [0, count), written to out[0 .. count). Taking the index instead of a
+// precomputed start means a pixel gets the same coordinate whichever row,
+// column, tile or coarse pass asks for it.
+// For the Julia set the points are z0 and julia_c is c, otherwise they are c.
+// Points that have not escaped after max_iterations get interior_escape_value().
+// Runs on whichever kernel init_kernels() picked. Returns how many points
+// in_main_cardioid_or_bulb() answered; compute_span() adds up the stats.
+int escape_span(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                int max_iterations);
+
+// escape_span() for points given as the double-double origin + origin_low
+// plus a double offset, used where double alone cannot tell pixels apart
+int escape_span_dd(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                   Complex step, int is_julia, Complex julia_c, int max_iterations);
+
+// escape_span() iterated in single precision, for views coarse enough that
+// float still separates neighbouring pixels
+int escape_span_float(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                      int max_iterations);
+
+// Without a renderer the frame buffer has no texture and is only rendered to memory
+int init_frame_buffer(FrameBuffer* fb, SDL_Renderer* renderer, int width, int height);
+void upload_frame_buffer(FrameBuffer* fb);
+void destroy_frame_buffer(FrameBuffer* fb);
+
+// Cheapest precision that still resolves every pixel of view over max_iterations
+Precision choose_precision(ViewPort view, int width, int height, int max_iterations);
+const char* precision_name(Precision precision);
+// fixed_limit if it is positive, otherwise a limit that grows with the zoom.
+// It moves in whole doublings of DEFAULT_ITERATIONS so the colors, which are
+// normalized by the limit, stay put between steps.
+int choose_iteration_limit(ViewPort view, int fixed_limit);
+// A grid for float, double or double-double precision, see make_perturbation_grid() for the rest
+PixelGrid make_pixel_grid(ViewPort view, int width, int height, int is_julia, Complex julia_c, int max_iterations);
+// Offset of the origin of grid from the origin of previous, in the same frame
+Complex grid_origin_shift(const PixelGrid* previous, const PixelGrid* grid);
+// Escape values of the count pixels (x, y), (x + dx, y + dy), ... of grid
+// into out[0 .. count), in the precision the grid asks for. One of dx and
+// dy has to be 0.
+void compute_span(const PixelGrid* grid, int* out, int x, int y, int dx, int dy, int count);
+// escape values of pixels [x0, x1) of row y into out[0 .. x1 - x0)
+void compute_row(const PixelGrid* grid, int* out, int y, int x0, int x1);
+// escape values of pixels [y0, y1) of column x into out[0], out[stride], ...
+void compute_column(const PixelGrid* grid, int* out, int stride, int x, int y0, int y1);
+
+void render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* grid, RenderStrategy strategy);
+// Reuses the frame rendered for previous when grid only pans it by whole
+// pixels: the frame is shifted and just the pixels scrolled into view are
+// computed. Returns 0 and leaves the frame alone if the grids differ in any
+// other way or nothing of the old frame stays visible.
+int scroll_render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* previous, const PixelGrid* grid,
+                  RenderStrategy strategy);
+// Recomputes the frame last passed to render() by brute force and returns
+// how many pixels differ in escape count, or -1 if the comparison buffer could not be allocated.
+int validate_render(ThreadPool* pool, FrameBuffer* fb, const PixelGrid* grid);
+
+#endif 
@@ -0,0 +1,159 @@
+#include "mariani_silver.h"
+#include "perturbation.h"
+
+// below this many interior pixels splitting costs more than computing them
+#define MIN_SPLIT_AREA 64
+
+static int is_sampled(int x, int y, int sampled) {
+    return sampled > 1 && x % sampled == 0 && y % sampled == 0;
+}
+
+// compute_row() for pixels [x0, x1) of row y that is not sampled yet. On a
+// sampled row every offset between the samples is one strided span.
+static void compute_new_row(const PixelGrid* grid, int* iterations, int stride, int y, int x0, int x1,
+                            int sampled) {
+    int* row = iterations + y * stride;
+    if (sampled <= 1 || y % sampled != 0) {
+        compute_row(grid, row + x0, y, x0, x1);
+        return;
+    }
+    
+    int samples[TILE_SIZE];
+    for (int offset = 1; offset < sampled; offset++) {
+        int first = x0 + ((offset - x0 % sampled) % sampled + sampled) % sampled;
+        if (first >= x1)
+            continue;
+        int count = (x1 - first + sampled - 1) / sampled;
+        compute_span(grid, samples, first, y, sampled, 0, count);
+        for (int i = 0; i < count; i++) {
+            row[first + i * sampled] = samples[i];
+        }
+    }
+}
+
+// compute_column() that leaves the samples of column x alone, like compute_new_row()
+static void compute_new_column(const PixelGrid* grid, int* iterations, int stride, int x, int y0, int y1,
+                               int sampled) {
+    if (sampled <= 1 || x % sampled != 0) {
+        compute_column(grid, iterations + y0 * stride + x, stride, x, y0, y1);
+        return;
+    }
+    
+    int samples[TILE_SIZE];
+    for (int offset = 1; offset < sampled; offset++) {
+        int first = y0 + ((offset - y0 % sampled) % sampled + sampled) % sampled;
+        if (first >= y1)
+            continue;
+        int count = (y1 - first + sampled - 1) / sampled;
+        compute_span(grid, samples, x, first, 0, sampled, count);
+        for (int i = 0; i < count; i++) {
+            iterations[(first + i * sampled) * stride + x] = samples[i];
+        }
+    }
+}
+
+// Only the counts have to match, the smooth fractions along a border always differ
+static int border_is_uniform(const int* iterations, int stride, int left, int top, int right, int bottom) {
+    int count = escape_count(iterations[top * stride + left]);
+    
+    for (int x = left; x <= right; x++) {
+        if (escape_count(iterations[top * stride + x]) != count ||
+            escape_count(iterations[bottom * stride + x]) != count)
+            return 0;
+    }
+    for (int y = top + 1; y < bottom; y++) {
+        if (escape_count(iterations[y * stride + left]) != count ||
+            escape_count(iterations[y * stride + right]) != count)
+            return 0;
+    }
+    return 1;
+}
+
+// Fills the inside of a uniform box with its count, blending the fractions
+// of the four corners so the box does not show up as a flat patch. Samples
+// already computed are kept.
+static void fill_box(int* iterations, int stride, int left, int top, int right, int bottom, int sampled) {
+    int value = iterations[top * stride + left];
+    if (value == GLITCHED || (value & ESCAPE_INTERIOR)) {
+        for (int y = top + 1; y < bottom; y++) {
+            for (int x = left + 1; x < right; x++) {
+                if (!is_sampled(x, y, sampled)) {
+                    iterations[y * stride + x] = value;
+                }
+            }
+        }
+        return;
+    }
+    
+    int count = escape_count(value);
+    double top_left = escape_fraction(value);
+    double top_right = escape_fraction(iterations[top * stride + right]);
+    double bottom_left = escape_fraction(iterations[bottom * stride + left]);
+    double bottom_right = escape_fraction(iterations[bottom * stride + right]);
+    for (int y = top + 1; y < bottom; y++) {
+        double v = (double)(y - top) / (bottom - top);
+        double row_left = top_left + (bottom_left - top_left) * v;
+        double row_right = top_right + (bottom_right - top_right) * v;
+        for (int x = left + 1; x < right; x++) {
+            if (is_sampled(x, y, sampled))
+                continue;
+            double u = (double)(x - left) / (right - left);
+            iterations[y * stride + x] = make_escape_value(count, row_left + (row_right - row_left) * u,
+                                                           ESCAPE_ESTIMATED);
+        }
+    }
+}
+
+// The borders of [left, right] x [top, bottom] (inclusive) are already computed
+static void subdivide(const PixelGrid* grid, int* iterations, int stride,
+                      int left, int top, int right, int bottom, int sampled) {
+    int inner_width = right - left - 1;
+    int inner_height = bottom - top - 1;
+    if (inner_width <= 0 || inner_height <= 0) {
+        return;
+    }
+    
+    if (border_is_uniform(iterations, stride, left, top, right, bottom)) {
+        fill_box(iterations, stride, left, top, right, bottom, sampled);
+        return;
+    }
+    
+    if (inner_width * inner_height <= MIN_SPLIT_AREA) {
+        for (int y = top + 1; y < bottom; y++) {
+            compute_new_row(grid, iterations, stride, y, left + 1, right, sampled);
+        }
+        return;
+    }
+    
+    // split the longer side; the new line becomes a border of both halves
+    if (inner_width >= inner_height) {
+        int middle = (left + right) / 2;
+        compute_new_column(grid, iterations, stride, middle, top + 1, bottom, sampled);
+        subdivide(grid, iterations, stride, left, top, middle, bottom, sampled);
+        subdivide(grid, iterations, stride, middle, top, right, bottom, sampled);
+    } else {
+        int middle = (top + bottom) / 2;
+        compute_new_row(grid, iterations, stride, middle, left + 1, right, sampled);
+        subdivide(grid, iterations, stride, left, top, right, middle, sampled);
+        subdivide(grid, iterations, stride, left, middle, right, bottom, sampled);
+    }
+}
+
+void mariani_silver_tile(const PixelGrid* grid, int* iterations, int stride,
+                         int x0, int y0, int x1, int y1, int sampled) {
+    int right = x1 - 1;
+    int bottom = y1 - 1;
+    
+    compute_new_row(grid, iterations, stride, y0, x0, x1, sampled);
+    if (bottom > y0) {
+        compute_new_row(grid, iterations, stride, bottom, x0, x1, sampled);
+    }
+    if (bottom - y0 > 1) {
+        compute_new_column(grid, iterations, stride, x0, y0 + 1, bottom, sampled);
+        if (right > x0) {
+            compute_new_column(grid, iterations, stride, right, y0 + 1, bottom, sampled);
+        }
+    }
+    
+    subdivide(grid, iterations, stride, x0, y0, right, bottom, sampled);
+}
@@ -0,0 +1,20 @@
+#ifndef MARIANI_SILVER_H
+#define MARIANI_SILVER_H
+
+#include "mandelbrot.h"
+
+// Mariani-Silver subdivision: computes only the border of the rectangle
+// [x0, x1) x [y0, y1). A border with a single escape count is assumed to
+// enclose nothing else and is filled, with smooth fractions blended from its
+// corners and marked ESCAPE_ESTIMATED; otherwise the rectangle is split
+// in two and each half is handled the same way. Much cheaper than brute
+// force inside the set and in wide escape bands, but it can miss detail that
+// does not touch a border; validate_render() reports how much.
+//
+// Pixels whose x and y are both multiples of sampled already hold their
+// values, from the coarse passes of a progressive render, and are neither
+// computed again nor filled over. 0 when nothing is sampled yet.
+void mariani_silver_tile(const PixelGrid* grid, int* iterations, int stride,
+                         int x0, int y0, int x1, int y1, int sampled);
+
+#endif
@@ -1,64 +1,117 @@
-#include "mouse_handler.h"
-
-void handle_mouse(SDL_Event event, MouseState* mouse, ViewPort* view) {
-    switch (event.type) {
-        case SDL_MOUSEBUTTONDOWN:
-            if (event.button.button == SDL_BUTTON_LEFT) {
-                mouse->is_dragging = 1;
-                mouse->start_x = event.button.x;
-                mouse->start_y = event.button.y;
-                mouse->original_view = *view;
-            }
-            break;
-            
-        case SDL_MOUSEBUTTONUP:
-            if (event.button.button == SDL_BUTTON_LEFT) {
-                mouse->is_dragging = 0;
-            }
-            break;
-            
-        case SDL_MOUSEWHEEL:
-            {
-                int x, y;
-                SDL_GetMouseState(&x, &y);
-                
-                double mouse_real = view->x_min + (x * (view->x_max - view->x_min)) / WINDOW_WIDTH;
-                double mouse_imag = view->y_min + (y * (view->y_max - view->y_min)) / WINDOW_HEIGHT;
-                
-                double zoom_factor = event.wheel.y > 0 ? 0.9 : 1.1;
-                
-                double new_width = (view->x_max - view->x_min) * zoom_factor;
-                double new_height = (view->y_max - view->y_min) * zoom_factor;
-                
-                view->x_min = mouse_real - (mouse_real - view->x_min) * zoom_factor;
-                view->x_max = mouse_real + (view->x_max - mouse_real) * zoom_factor;
-                view->y_min = mouse_imag - (mouse_imag - view->y_min) * zoom_factor;
-                view->y_max = mouse_imag + (view->y_max - mouse_imag) * zoom_factor;
-                
-                view->zoom *= (1.0 / zoom_factor);
-            }
-            break;
-            
-        case SDL_MOUSEMOTION:
-            if (mouse->is_dragging) {
-                int dx = event.motion.x - mouse->start_x;
-                int dy = event.motion.y - mouse->start_y;
-                
-                double scale_x = (mouse->original_view.x_max - mouse->original_view.x_min) / WINDOW_WIDTH;
-                double scale_y = (mouse->original_view.y_max - mouse->original_view.y_min) / WINDOW_HEIGHT;
-                
-                view->x_min = mouse->original_view.x_min - dx * scale_x;
-                view->x_max = mouse->original_view.x_max - dx * scale_x;
-                view->y_min = mouse->original_view.y_min - dy * scale_y;
-                view->y_max = mouse->original_view.y_max - dy * scale_y;
-            }
-            break;
-    }
-}
-
-Complex get_complex_from_mouse(int x, int y, ViewPort view, int width, int height) {
-    Complex c;
-    c.real = view.x_min + (x * (view.x_max - view.x_min)) / width;
-    c.imag = view.y_min + (y * (view.y_max - view.y_min)) / height;
-    return c;
-} 
+#include "mouse_handler.h"
+#include <math.h>
+
+// Deepest zoom: a pixel keeps this many fraction bits of the center below it
+// so that dragging by one pixel still moves the view exactly
+#define PIXEL_GUARD_BITS 16
+
+static void normalize_view(ViewPort* view) {
+    int exponent;
+    double width = frexp(view->width, &exponent);
+    view->height = ldexp(view->height, -exponent);
+    view->width = width;
+    view->scale_exponent += exponent;
+}
+
+ViewPort make_view(double center_real, double center_imag, double width, double height) {
+    ViewPort view = {
+        .width = width,
+        .height = height,
+        .scale_exponent = 0,
+        .zoom = 1.0
+    };
+    fixed_from_double(&view.center_real, center_real);
+    fixed_from_double(&view.center_imag, center_imag);
+    normalize_view(&view);
+    return view;
+}
+
+double get_view_width(ViewPort view) {
+    return ldexp(view.width, view.scale_exponent);
+}
+
+double get_view_height(ViewPort view) {
+    return ldexp(view.height, view.scale_exponent);
+}
+
+// offset of pixel (x, y) from the center of the view
+static Complex mouse_offset(int x, int y, ViewPort view, int width, int height) {
+    Complex offset = {
+        (x - width * 0.5) * get_view_width(view) / width,
+        (y - height * 0.5) * get_view_height(view) / height
+    };
+    return offset;
+}
+
+void handle_mouse(SDL_Event event, MouseState* mouse, ViewPort* view) {
+    switch (event.type) {
+        case SDL_MOUSEBUTTONDOWN:
+            if (event.button.button == SDL_BUTTON_LEFT) {
+                mouse->is_dragging = 1;
+                mouse->start_x = event.button.x;
+                mouse->start_y = event.button.y;
+                mouse->original_view = *view;
+            }
+            break;
+            
+        case SDL_MOUSEBUTTONUP:
+            if (event.button.button == SDL_BUTTON_LEFT) {
+                mouse->is_dragging = 0;
+            }
+            break;
+            
+        case SDL_MOUSEWHEEL:
+            {
+                int x, y;
+                SDL_GetMouseState(&x, &y);
+                
+                double zoom_factor = event.wheel.y > 0 ? 0.9 : 1.1;
+                
+                double pixel_size = get_view_width(*view) * zoom_factor / WINDOW_WIDTH;
+                if (zoom_factor < 1.0 && pixel_size < ldexp(1.0, PIXEL_GUARD_BITS - FIXED_FRACTION_BITS)) {
+                    break;
+                }
+                
+                // keep the point under the mouse in place, found in fixed
+                // point so it does not drift at depths past double
+                Fixed point_real, point_imag;
+                get_fixed_from_mouse(x, y, *view, WINDOW_WIDTH, WINDOW_HEIGHT, &point_real, &point_imag);
+                view->width *= zoom_factor;
+                view->height *= zoom_factor;
+                normalize_view(view);
+                Complex offset = mouse_offset(x, y, *view, WINDOW_WIDTH, WINDOW_HEIGHT);
+                fixed_add_double(&view->center_real, &point_real, -offset.real);
+                fixed_add_double(&view->center_imag, &point_imag, -offset.imag);
+                
+                view->zoom *= (1.0 / zoom_factor);
+            }
+            break;
+            
+        case SDL_MOUSEMOTION:
+            if (mouse->is_dragging) {
+                int dx = event.motion.x - mouse->start_x;
+                int dy = event.motion.y - mouse->start_y;
+                
+                double scale_x = get_view_width(mouse->original_view) / WINDOW_WIDTH;
+                double scale_y = get_view_height(mouse->original_view) / WINDOW_HEIGHT;
+                
+                fixed_add_double(&view->center_real, &mouse->original_view.center_real, -dx * scale_x);
+                fixed_add_double(&view->center_imag, &mouse->original_view.center_imag, -dy * scale_y);
+            }
+            break;
+    }
+}
+
+Complex get_complex_from_mouse(int x, int y, ViewPort view, int width, int height) {
+    Complex offset = mouse_offset(x, y, view, width, height);
+    Complex c;
+    c.real = fixed_to_double(&view.center_real) + offset.real;
+    c.imag = fixed_to_double(&view.center_imag) + offset.imag;
+    return c;
+}
+
+void get_fixed_from_mouse(int x, int y, ViewPort view, int width, int height, Fixed* real, Fixed* imag) {
+    Complex offset = mouse_offset(x, y, view, width, height);
+    fixed_add_double(real, &view.center_real, offset.real);
+    fixed_add_double(imag, &view.center_imag, offset.imag);
+}
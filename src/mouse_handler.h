@@ -1,32 +1,45 @@
-#ifndef MOUSE_HANDLER_H
-#define MOUSE_HANDLER_H
-
-#include <SDL.h>
-
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
-
-typedef struct {
-    double x_min;
-    double x_max;
-    double y_min;
-    double y_max;
-    double zoom;
-} ViewPort;
-
-typedef struct {
-    int is_dragging;
-    int start_x;
-    int start_y;
-    ViewPort original_view;
-} MouseState;
-
-typedef struct {
-    double real;
-    double imag;
-} Complex;
-
-void handle_mouse(SDL_Event event, MouseState* mouse, ViewPort* view);
-Complex get_complex_from_mouse(int x, int y, ViewPort view, int width, int height);
-
+#ifndef MOUSE_HANDLER_H
+#define MOUSE_HANDLER_H
+
+#include <SDL.h>
+#include "fixed_point.h"
+
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 600
+
+// The visible region is centered on center_real + center_imag i and spans
+// ldexp(width, scale_exponent) by ldexp(height, scale_exponent). The center
+// keeps every bit at any depth, the exponent carries the depth so the
+// width and height mantissas stay near 1.
+typedef struct {
+    Fixed center_real;
+    Fixed center_imag;
+    double width;
+    double height;
+    int scale_exponent;
+    double zoom;
+} ViewPort;
+
+typedef struct {
+    int is_dragging;
+    int start_x;
+    int start_y;
+    ViewPort original_view;
+} MouseState;
+
+typedef struct {
+    double real;
+    double imag;
+} Complex;
+
+ViewPort make_view(double center_real, double center_imag, double width, double height);
+double get_view_width(ViewPort view);
+double get_view_height(ViewPort view);
+
+void handle_mouse(SDL_Event event, MouseState* mouse, ViewPort* view);
+Complex get_complex_from_mouse(int x, int y, ViewPort view, int width, int height);
+// get_complex_from_mouse() without rounding the point to doubles, for
+// anything that moves the view center to or around a mouse position
+void get_fixed_from_mouse(int x, int y, ViewPort view, int width, int height, Fixed* real, Fixed* imag);
+
 #endif 
\ No newline at end of file
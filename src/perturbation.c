@@ -0,0 +1,330 @@
+#include "perturbation.h"
+#include "coloring.h"
+#include "kernels.h"
+#include <math.h>
+#include <stdlib.h>
+
+ReferenceOrbit* create_reference_orbit(const Fixed* real, const Fixed* imag, int is_julia, Complex julia_c,
+                                       int max_iterations) {
+    ReferenceOrbit* reference = calloc(1, sizeof(ReferenceOrbit));
+    if (!reference) {
+        return NULL;
+    }
+    reference->orbit_real = malloc(sizeof(double) * (max_iterations + 1));
+    reference->orbit_imag = malloc(sizeof(double) * (max_iterations + 1));
+    reference->glitch_limit = malloc(sizeof(double) * (max_iterations + 1));
+    if (!reference->orbit_real || !reference->orbit_imag || !reference->glitch_limit) {
+        destroy_reference_orbit(reference);
+        return NULL;
+    }
+    reference->real = *real;
+    reference->imag = *imag;
+    reference->is_julia = is_julia;
+    reference->julia_c = julia_c;
+    reference->max_iterations = max_iterations;
+    
+    Fixed z_real, z_imag, c_real, c_imag;
+    if (is_julia) {
+        z_real = *real;
+        z_imag = *imag;
+        fixed_from_double(&c_real, julia_c.real);
+        fixed_from_double(&c_imag, julia_c.imag);
+    } else {
+        fixed_from_double(&z_real, 0.0);
+        fixed_from_double(&z_imag, 0.0);
+        c_real = *real;
+        c_imag = *imag;
+    }
+    
+    int n = 0;
+    for (;;) {
+        double zr = fixed_to_double(&z_real);
+        double zi = fixed_to_double(&z_imag);
+        double magnitude = zr * zr + zi * zi;
+        reference->orbit_real[n] = zr;
+        reference->orbit_imag[n] = zi;
+        reference->glitch_limit[n] = GLITCH_TOLERANCE * GLITCH_TOLERANCE * magnitude;
+        n++;
+        if (n > max_iterations || magnitude > 4) {
+            break;
+        }
+        
+        Fixed real_squared, imag_squared, cross;
+        fixed_square(&real_squared, &z_real);
+        fixed_square(&imag_squared, &z_imag);
+        fixed_mul(&cross, &z_real, &z_imag);
+        fixed_sub(&z_real, &real_squared, &imag_squared);
+        fixed_add(&z_real, &z_real, &c_real);
+        fixed_add(&z_imag, &cross, &cross);
+        fixed_add(&z_imag, &z_imag, &c_imag);
+    }
+    reference->length = n;
+    return reference;
+}
+
+void destroy_reference_orbit(ReferenceOrbit* reference) {
+    if (!reference) {
+        return;
+    }
+    free(reference->orbit_real);
+    free(reference->orbit_imag);
+    free(reference->glitch_limit);
+    free(reference);
+}
+
+ReferenceOrbit* create_view_reference(ViewPort view, int is_julia, Complex julia_c, int max_iterations) {
+    return create_reference_orbit(&view.center_real, &view.center_imag, is_julia, julia_c, max_iterations);
+}
+
+int reference_covers(const ReferenceOrbit* reference, ViewPort view, int is_julia, Complex julia_c,
+                     int max_iterations) {
+    if (!reference || reference->is_julia != is_julia || reference->max_iterations != max_iterations ||
+        (is_julia && (reference->julia_c.real != julia_c.real || reference->julia_c.imag != julia_c.imag))) {
+        return 0;
+    }
+    return fabs(fixed_difference(&reference->real, &view.center_real)) <= get_view_width(view) / 2 &&
+           fabs(fixed_difference(&reference->imag, &view.center_imag)) <= get_view_height(view) / 2;
+}
+
+PixelGrid make_perturbation_grid(ViewPort view, int width, int height, const ReferenceOrbit* reference) {
+    PixelGrid grid = make_pixel_grid(view, width, height, reference->is_julia, reference->julia_c,
+                                     reference->max_iterations);
+    grid.origin_low.real = 0.0;
+    grid.origin_low.imag = 0.0;
+    grid.origin.real = fixed_difference(&view.center_real, &reference->real) - get_view_width(view) / 2;
+    grid.origin.imag = fixed_difference(&view.center_imag, &reference->imag) - get_view_height(view) / 2;
+    grid.precision = PRECISION_PERTURBATION;
+    grid.reference = reference;
+    return grid;
+}
+
+Complex grid_frame_offset(const PixelGrid* previous, const PixelGrid* grid) {
+    Fixed real, imag;
+    fixed_from_double(&real, 0.0);
+    fixed_from_double(&imag, 0.0);
+    if (grid->reference) {
+        real = grid->reference->real;
+        imag = grid->reference->imag;
+    }
+    if (previous->reference) {
+        fixed_sub(&real, &real, &previous->reference->real);
+        fixed_sub(&imag, &imag, &previous->reference->imag);
+    }
+    
+    Complex offset = {fixed_to_double(&real), fixed_to_double(&imag)};
+    return offset;
+}
+
+static int perturbed_escape_time(const ReferenceOrbit* reference, Complex delta) {
+    const double* orbit_real = reference->orbit_real;
+    const double* orbit_imag = reference->orbit_imag;
+    
+    // for the Mandelbrot set the pixel offsets c, for a Julia set z0
+    double dr = reference->is_julia ? delta.real : 0.0;
+    double di = reference->is_julia ? delta.imag : 0.0;
+    double dc_real = reference->is_julia ? 0.0 : delta.real;
+    double dc_imag = reference->is_julia ? 0.0 : delta.imag;
+    int last = SDL_min(reference->max_iterations, reference->length - 1);
+    int n;
+    
+    for (n = 0; n < last; n++) {
+        double zr = orbit_real[n];
+        double zi = orbit_imag[n];
+        double temp_real = 2 * (zr * dr - zi * di) + dr * dr - di * di + dc_real;
+        double temp_imag = 2 * (zr * di + zi * dr) + 2 * dr * di + dc_imag;
+        dr = temp_real;
+        di = temp_imag;
+        
+        double real = orbit_real[n + 1] + dr;
+        double imag = orbit_imag[n + 1] + di;
+        double magnitude = real * real + imag * imag;
+        if (magnitude > 4)
+            return escaped_value(n, magnitude);
+        if (magnitude < reference->glitch_limit[n + 1])
+            return GLITCHED;
+    }
+    // the reference escaped before this pixel did
+    return n == reference->max_iterations ? interior_escape_value(n) : GLITCHED;
+}
+
+void perturbation_span(int* out, int first, int stride, int count, Complex origin, Complex step,
+                       const ReferenceOrbit* reference) {
+    for (int i = 0; i < count; i++) {
+        int index = first + i * stride;
+        Complex delta = {origin.real + index * step.real, origin.imag + index * step.imag};
+        out[i] = perturbed_escape_time(reference, delta);
+    }
+}
+
+typedef struct {
+    const PixelGrid* grid;
+    const ReferenceOrbit* reference;
+    Complex shift;          // offset of reference from the primary reference
+    int* iterations;
+    Uint32* pixels;
+    int width;
+} RepairJob;
+
+static void repair_row(void* context, int y) {
+    RepairJob* job = context;
+    const PixelGrid* grid = job->grid;
+    int* row = job->iterations + y * job->width;
+    int repaired = 0;
+    Uint64 iterations = 0;
+    
+    for (int x = 0; x < job->width; x++) {
+        if (row[x] != GLITCHED)
+            continue;
+        
+        Complex delta = {grid->origin.real + x * grid->step_x - job->shift.real,
+                         grid->origin.imag + y * grid->step_y - job->shift.imag};
+        row[x] = perturbed_escape_time(job->reference, delta);
+        iterations += escape_count(SDL_max(row[x], 0));
+        if (job->pixels) {
+            job->pixels[y * job->width + x] = color_escape_value(row[x], grid->max_iterations);
+        }
+        repaired++;
+    }
+    if (!grid->untracked) {
+        add_kernel_stats(repaired, 0);
+        add_kernel_iterations(iterations);
+    }
+}
+
+// the glitched pixel nearest to the centroid of all of them, 0 if there are none
+static int find_glitch(const int* iterations, int width, int height, int* glitch_x, int* glitch_y) {
+    double sum_x = 0.0, sum_y = 0.0;
+    int count = 0;
+    for (int i = 0; i < width * height; i++) {
+        if (iterations[i] == GLITCHED) {
+            sum_x += i % width;
+            sum_y += i / width;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    
+    double center_x = sum_x / count;
+    double center_y = sum_y / count;
+    double best = INFINITY;
+    for (int i = 0; i < width * height; i++) {
+        if (iterations[i] != GLITCHED)
+            continue;
+        double dx = i % width - center_x;
+        double dy = i / width - center_y;
+        if (dx * dx + dy * dy < best) {
+            best = dx * dx + dy * dy;
+            *glitch_x = i % width;
+            *glitch_y = i / width;
+        }
+    }
+    return 1;
+}
+
+static ReferenceOrbit* create_shifted_reference(const ReferenceOrbit* primary, Complex shift) {
+    Fixed real, imag;
+    fixed_add_double(&real, &primary->real, shift.real);
+    fixed_add_double(&imag, &primary->imag, shift.imag);
+    return create_reference_orbit(&real, &imag, primary->is_julia, primary->julia_c, primary->max_iterations);
+}
+
+// A neighbour's value standing in for a pixel
+static int estimated_value(int value) {
+    return value == GLITCHED ? GLITCHED : value | ESCAPE_ESTIMATED;
+}
+
+// Fills every run of GLITCHED values in values[0], values[stride], ...
+// values[(count - 1) * stride] from the nearer end of the run. Runs without
+// an end that is not GLITCHED stay as they are.
+static void estimate_line(int* values, int stride, int count) {
+    int previous = -1;
+    for (int i = 0; i <= count; i++) {
+        if (i < count && values[i * stride] == GLITCHED)
+            continue;
+        
+        for (int j = previous + 1; j < i; j++) {
+            int source = previous < 0 ? i : i == count || j - previous <= i - j ? previous : i;
+            if (source < count) {
+                values[j * stride] = estimated_value(values[source * stride]);
+            }
+        }
+        previous = i;
+    }
+}
+
+typedef struct {
+    int* iterations;
+    int width;
+} EstimateJob;
+
+static void estimate_row(void* context, int y) {
+    EstimateJob* job = context;
+    estimate_line(job->iterations + y * job->width, 1, job->width);
+}
+
+void start_glitch_repair(GlitchRepair* repair) {
+    repair->references = 0;
+    repair->finished = 0;
+}
+
+int continue_glitch_repair(GlitchRepair* repair, ThreadPool* pool, const PixelGrid* grid, int* iterations,
+                           Uint32* pixels, int width, int height, double budget_ms) {
+    const ReferenceOrbit* primary = grid->reference;
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 budget = (Uint64)(budget_ms * SDL_GetPerformanceFrequency() / 1000.0);
+    
+    // one secondary reference at a time, its orbit is the bulk of the work
+    int x = 0, y = 0;
+    while (!repair->finished) {
+        if (!primary || !find_glitch(iterations, width, height, &x, &y)) {
+            repair->finished = 1;
+            break;
+        }
+        
+        ReferenceOrbit* secondary = NULL;
+        Complex shift = {grid->origin.real + x * grid->step_x, grid->origin.imag + y * grid->step_y};
+        if (repair->references < MAX_REFERENCES) {
+            secondary = create_shifted_reference(primary, shift);
+        }
+        if (secondary) {
+            RepairJob job = {grid, secondary, shift, iterations, pixels, width};
+            run_thread_pool(pool, repair_row, &job, height);
+            destroy_reference_orbit(secondary);
+            repair->references++;
+        } else {
+            // out of references; a pixel's own point would have to be
+            // iterated in fixed point, so it takes its neighbours' value
+            EstimateJob job = {iterations, width};
+            run_thread_pool(pool, estimate_row, &job, height);
+            for (int column = 0; column < width; column++) {
+                estimate_line(iterations + column, width, height);
+            }
+            for (int i = 0; i < width * height; i++) {
+                if (iterations[i] == GLITCHED) {
+                    iterations[i] = interior_escape_value(grid->max_iterations) | ESCAPE_ESTIMATED;
+                }
+                // recolors Mariani-Silver fills as well, to the color they already have
+                if (pixels && (iterations[i] & ESCAPE_ESTIMATED)) {
+                    pixels[i] = color_escape_value(iterations[i], grid->max_iterations);
+                }
+            }
+            repair->finished = 1;
+            break;
+        }
+        
+        if (SDL_GetPerformanceCounter() - start >= budget) {
+            break;
+        }
+    }
+    return repair->finished;
+}
+
+void repair_glitches(ThreadPool* pool, const PixelGrid* grid, int* iterations, Uint32* pixels,
+                     int width, int height) {
+    GlitchRepair repair;
+    start_glitch_repair(&repair);
+    while (!continue_glitch_repair(&repair, pool, grid, iterations, pixels, width, height, 0.0)) {
+    }
+}
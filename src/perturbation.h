@@ -0,0 +1,70 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include "mandelbrot.h"
+#include "fixed_point.h"
+
+// Pauldelbrot's criterion: a pixel whose orbit gets this much closer to zero
+// than the reference orbit has lost its precision and is marked GLITCHED
+#define GLITCH_TOLERANCE 1e-3
+
+// Escape value of a pixel that has to be redone against another reference
+#define GLITCHED -1
+
+// Secondary references tried per frame before leftover glitches are estimated from their neighbours
+#define MAX_REFERENCES 16
+
+// Orbit of one point computed in fixed point and kept as doubles, pixels are
+// then iterated as small double deltas from it:
+//   d[n+1] = 2 Z[n] d[n] + d[n]^2 + dc
+struct ReferenceOrbit {
+    Fixed real;
+    Fixed imag;
+    int is_julia;
+    Complex julia_c;
+    int max_iterations;     // iteration limit of the pixels it serves
+    int length;             // Z[0 .. length), shorter than max_iterations + 1 if it escapes
+    double* orbit_real;
+    double* orbit_imag;
+    double* glitch_limit;   // GLITCH_TOLERANCE^2 * |Z[n]|^2
+};
+
+ReferenceOrbit* create_reference_orbit(const Fixed* real, const Fixed* imag, int is_julia, Complex julia_c,
+                                       int max_iterations);
+void destroy_reference_orbit(ReferenceOrbit* reference);
+
+// Center of view as a reference point
+ReferenceOrbit* create_view_reference(ViewPort view, int is_julia, Complex julia_c, int max_iterations);
+// Whether reference can serve view: same fractal, same limit and a point inside the view
+int reference_covers(const ReferenceOrbit* reference, ViewPort view, int is_julia, Complex julia_c,
+                     int max_iterations);
+// Like make_pixel_grid(), but the grid origin is the offset of pixel (0, 0) from the reference
+PixelGrid make_perturbation_grid(ViewPort view, int width, int height, const ReferenceOrbit* reference);
+// Offset of the frame of grid from the frame of previous, zero for grids on the same reference
+Complex grid_frame_offset(const PixelGrid* previous, const PixelGrid* grid);
+
+// escape_span() for points given as offsets from the reference
+void perturbation_span(int* out, int first, int stride, int count, Complex origin, Complex step,
+                       const ReferenceOrbit* reference);
+
+// Glitch repair of one frame, a secondary reference at a time
+typedef struct {
+    int references;         // secondary references used so far
+    int finished;
+} GlitchRepair;
+
+void start_glitch_repair(GlitchRepair* repair);
+// Recomputes the GLITCHED pixels of a width x height frame rendered on grid
+// against secondary references placed on them, and recolors them if pixels
+// is not NULL. Places references until budget_ms is used up, at least one
+// per call. Pixels still GLITCHED after MAX_REFERENCES take the value of
+// the nearest repaired pixel in their row or column, marked
+// ESCAPE_ESTIMATED. Returns 1 once no pixel is GLITCHED; grids without a
+// reference are finished at once.
+int continue_glitch_repair(GlitchRepair* repair, ThreadPool* pool, const PixelGrid* grid, int* iterations,
+                           Uint32* pixels, int width, int height, double budget_ms);
+// The whole repair at once
+void repair_glitches(ThreadPool* pool, const PixelGrid* grid, int* iterations, Uint32* pixels,
+                     int width, int height);
+
+#endif
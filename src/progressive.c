@@ -0,0 +1,190 @@
+#include "progressive.h"
+#include <stdlib.h>
+#include <string.h>
+#include "coloring.h"
+#include "mariani_silver.h"
+
+// tiles per worker in one slice, enough for stealing to even out the load
+// while keeping a slice short against the budget
+#define TILES_PER_WORKER 4
+
+typedef struct {
+    const ProgressiveRender* progress;
+    FrameBuffer* fb;
+    int first_tile;
+} ProgressiveSlice;
+
+static int pass_block(int pass) {
+    return PROGRESSIVE_FIRST_BLOCK >> pass;
+}
+
+// Computes the samples of one row a pass is responsible for. On rows the
+// previous pass already sampled only the columns in between are new.
+static void sample_row(const ProgressiveRender* progress, int* row, int y, int x0, int x1, int block) {
+    int previous = block * 2;
+    int first = x0;
+    int stride = block;
+    if (progress->pass > progress->first_pass && y % previous == 0) {
+        first = x0 + block;
+        stride = previous;
+    }
+    if (first >= x1) {
+        return;
+    }
+    
+    int count = (x1 - first + stride - 1) / stride;
+    int samples[TILE_SIZE];
+    
+    compute_span(&progress->grid, samples, first, y, stride, 0, count);
+    for (int i = 0; i < count; i++) {
+        row[first + i * stride] = samples[i];
+    }
+}
+
+static void refine_tile(void* context, int task) {
+    ProgressiveSlice* slice = context;
+    const ProgressiveRender* progress = slice->progress;
+    FrameBuffer* fb = slice->fb;
+    int tile = slice->first_tile + task;
+    int block = pass_block(progress->pass);
+    
+    int x0 = (tile % progress->tiles_x) * TILE_SIZE;
+    int y0 = (tile / progress->tiles_x) * TILE_SIZE;
+    int x1 = SDL_min(x0 + TILE_SIZE, fb->width);
+    int y1 = SDL_min(y0 + TILE_SIZE, fb->height);
+    
+    if (block == 1 && progress->strategy == RENDER_MARIANI_SILVER) {
+        // every other pixel of every other row is left from the 2x2 pass
+        int sampled = progress->pass > progress->first_pass ? 2 : 0;
+        mariani_silver_tile(&progress->grid, fb->iterations, fb->width, x0, y0, x1, y1, sampled);
+    } else {
+        for (int y = y0; y < y1; y += block) {
+            sample_row(progress, fb->iterations + y * fb->width, y, x0, x1, block);
+        }
+    }
+    
+    if (block == 1) {
+        for (int y = y0; y < y1; y++) {
+            color_span(fb->iterations + y * fb->width + x0, fb->pixels + y * fb->width + x0, x1 - x0,
+                       progress->grid.max_iterations);
+        }
+        return;
+    }
+    
+    // tiles start on multiples of every block size, so each block is
+    // colored from the sample in its top left corner
+    for (int y = y0; y < y1; y += block) {
+        int block_bottom = SDL_min(y + block, y1);
+        for (int x = x0; x < x1; x += block) {
+            int block_right = SDL_min(x + block, x1);
+            Uint32 color = color_escape_value(fb->iterations[y * fb->width + x], progress->grid.max_iterations);
+            for (int by = y; by < block_bottom; by++) {
+                for (int bx = x; bx < block_right; bx++) {
+                    fb->pixels[by * fb->width + bx] = color;
+                }
+            }
+        }
+    }
+}
+
+void start_progressive_render(ProgressiveRender* progress, const FrameBuffer* fb, const PixelGrid* grid,
+                              RenderStrategy strategy) {
+    progress->grid = *grid;
+    progress->strategy = strategy;
+    progress->first_pass = 0;
+    progress->pass = 0;
+    progress->next_tile = 0;
+    progress->tiles_x = (fb->width + TILE_SIZE - 1) / TILE_SIZE;
+    progress->tile_count = progress->tiles_x * ((fb->height + TILE_SIZE - 1) / TILE_SIZE);
+    start_glitch_repair(&progress->repair);
+}
+
+// Source pixel along one axis for each destination pixel, -1 outside the old
+// frame. shift is how far the new origin lies from the old one.
+static void map_axis(int* source, int size, double shift, double step, double previous_step) {
+    for (int i = 0; i < size; i++) {
+        double position = (shift + i * step) / previous_step;
+        source[i] = position >= 0.0 && position < size ? (int)position : -1;
+    }
+}
+
+int reproject_frame(FrameBuffer* fb, const PixelGrid* previous, const PixelGrid* grid) {
+    if (grid->is_julia != previous->is_julia ||
+        (grid->is_julia && (grid->julia_c.real != previous->julia_c.real ||
+                            grid->julia_c.imag != previous->julia_c.imag))) {
+        return 0;
+    }
+    Complex shift = grid_origin_shift(previous, grid);
+    
+    Uint32* old_pixels = malloc(sizeof(Uint32) * fb->width * fb->height);
+    int* source_x = malloc(sizeof(int) * fb->width);
+    int* source_y = malloc(sizeof(int) * fb->height);
+    if (!old_pixels || !source_x || !source_y) {
+        free(old_pixels);
+        free(source_x);
+        free(source_y);
+        return 0;
+    }
+    
+    memcpy(old_pixels, fb->pixels, sizeof(Uint32) * fb->width * fb->height);
+    map_axis(source_x, fb->width, shift.real, grid->step_x, previous->step_x);
+    map_axis(source_y, fb->height, shift.imag, grid->step_y, previous->step_y);
+    
+    // nearest neighbour is enough for a picture that lives a few frames,
+    // whatever zooming out uncovers stays black until its tile is computed
+    for (int y = 0; y < fb->height; y++) {
+        Uint32* row = fb->pixels + y * fb->width;
+        const Uint32* old_row = source_y[y] >= 0 ? old_pixels + source_y[y] * fb->width : NULL;
+        for (int x = 0; x < fb->width; x++) {
+            row[x] = old_row && source_x[x] >= 0 ? old_row[source_x[x]] : pack_argb(0, 0, 0);
+        }
+    }
+    free(old_pixels);
+    free(source_x);
+    free(source_y);
+    
+    upload_frame_buffer(fb);
+    return 1;
+}
+
+void start_reprojected_render(ProgressiveRender* progress, FrameBuffer* fb, const PixelGrid* previous,
+                              const PixelGrid* grid, RenderStrategy strategy) {
+    start_progressive_render(progress, fb, grid, strategy);
+    if (reproject_frame(fb, previous, grid)) {
+        progress->first_pass = PROGRESSIVE_PASSES - 1;
+        progress->pass = progress->first_pass;
+    }
+}
+
+int continue_progressive_render(ProgressiveRender* progress, ThreadPool* pool, FrameBuffer* fb,
+                                double budget_ms) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 budget = (Uint64)(budget_ms * SDL_GetPerformanceFrequency() / 1000.0);
+    int slice_tiles = get_thread_pool_size(pool) * TILES_PER_WORKER;
+    
+    // at least one slice per call so a tight budget still makes progress
+    while (progress->pass < PROGRESSIVE_PASSES) {
+        ProgressiveSlice slice = {progress, fb, progress->next_tile};
+        int count = SDL_min(slice_tiles, progress->tile_count - progress->next_tile);
+        
+        run_thread_pool(pool, refine_tile, &slice, count);
+        progress->next_tile += count;
+        if (progress->next_tile == progress->tile_count) {
+            progress->pass++;
+            progress->next_tile = 0;
+        }
+        
+        if (SDL_GetPerformanceCounter() - start >= budget) {
+            break;
+        }
+    }
+    
+    // the repair gets what is left of the budget, or the next call
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    if (progress->pass == PROGRESSIVE_PASSES && elapsed < budget) {
+        continue_glitch_repair(&progress->repair, pool, &progress->grid, fb->iterations, fb->pixels,
+                               fb->width, fb->height, budget_ms - elapsed * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+    upload_frame_buffer(fb);
+    return progress->repair.finished;
+}
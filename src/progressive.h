@@ -0,0 +1,46 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include "mandelbrot.h"
+#include "perturbation.h"
+
+// Block sizes of the passes, every pass halves the previous one
+#define PROGRESSIVE_PASSES 4
+#define PROGRESSIVE_FIRST_BLOCK 8
+
+// Coarse-to-fine rendering: the frame is first sampled at every 8th pixel in
+// each direction and drawn as 8x8 blocks, then refined through 4x4, 2x2 and
+// single pixels. A pass only computes the pixels no earlier pass sampled, and
+// the work is handed out in slices so the event loop keeps running while a
+// frame refines.
+typedef struct {
+    PixelGrid grid;
+    RenderStrategy strategy;    // used for the full resolution pass
+    int first_pass;             // earlier passes are skipped, no samples to reuse
+    int pass;                   // PROGRESSIVE_PASSES once the frame is complete
+    int next_tile;
+    int tiles_x;
+    int tile_count;
+    GlitchRepair repair;        // runs once the passes are done
+} ProgressiveRender;
+
+void start_progressive_render(ProgressiveRender* progress, const FrameBuffer* fb, const PixelGrid* grid,
+                              RenderStrategy strategy);
+// Replaces the frame rendered for previous by itself resampled to grid and
+// uploads it. Returns 0 and leaves the frame alone if the grids differ in the
+// fractal or memory runs out.
+int reproject_frame(FrameBuffer* fb, const PixelGrid* previous, const PixelGrid* grid);
+// Starts a frame whose first picture is the previous frame, rendered for
+// previous, resampled to grid. Only the full resolution pass runs and
+// replaces the stand-in tile by tile, so a zoom shows up at once instead of
+// after a coarse pass. Falls back to start_progressive_render() if
+// reproject_frame() cannot make the stand-in.
+void start_reprojected_render(ProgressiveRender* progress, FrameBuffer* fb, const PixelGrid* previous,
+                              const PixelGrid* grid, RenderStrategy strategy);
+// Renders tiles of the pending passes, then repairs glitches, until budget_ms
+// is used up or the frame is complete, then uploads the frame buffer.
+// Returns 1 once the frame is complete.
+int continue_progressive_render(ProgressiveRender* progress, ThreadPool* pool, FrameBuffer* fb,
+                                double budget_ms);
+
+#endif
@@ -0,0 +1,1066 @@
+#include "kernels.h"
+#include "double_double.h"
+
+#if SIMD_KERNELS_AVAILABLE
+
+#include <immintrin.h>
+
+// Vector escape-time kernels. Every lane iterates its own pixel; as soon as
+// one lane escapes or hits the iteration limit its result is written out and the
+// lane is refilled with the next pixel of the span, so the vector never idles
+// on the long tail of a single slow point. Iteration counts are kept as
+// doubles so they can be updated and compared without leaving the register.
+//
+// Lanes run ITERATION_BLOCK iterations between checks. A lane that escapes
+// inside a block goes inactive and stops counting, and counts that ran past
+// the limit are clamped at the end of the block, so the results stay exact;
+// the block only amortises the refill test and the cycle detection. Interior points are caught Brent-style: each lane remembers its
+// orbit at power-of-two iteration counts and is finished with the limit
+// as soon as the orbit returns to within PERIODICITY_EPSILON.
+//
+// The iteration limit sits in a register the whole time, so unlike the scalar
+// kernels these gain nothing from copies specialized for a constant limit.
+//
+// Each kernel is compiled for its own ISA through a target attribute and is
+// only ever called after kernels.c has checked the CPU supports it.
+
+// lanes without a pixel sit at z = c = 0 with a count that never reaches the limit
+#define IDLE_ITERATIONS -1e18
+#define MAX_LANES 8
+#define ITERATION_BLOCK 8
+
+// The lane bookkeeping is plain C shared by every ISA. It has to be inlined
+// into each kernel: an out-of-line call compiled for the baseline target
+// would mix legacy SSE code with dirty AVX registers on every refill.
+#define LANE_HELPER static inline __attribute__((always_inline))
+
+// A lane only knows its count once it is done, and by then z has gone on
+// iterating past the escape for the rest of the block. The smooth fraction
+// needs |z|^2 at the escape, so that is found again in double from z at the
+// start of the block the lane escaped in.
+LANE_HELPER int lane_escape_value(int count, int max_iterations, double zr, double zi, double cr, double ci) {
+    if (count >= max_iterations) {
+        return interior_escape_value(max_iterations);
+    }
+    
+    for (int i = 0; i <= ITERATION_BLOCK; i++) {
+        double new_zi = 2.0 * zr * zi + ci;
+        zr = zr * zr - zi * zi + cr;
+        zi = new_zi;
+        double magnitude = zr * zr + zi * zi;
+        if (magnitude > 4.0) {
+            return escaped_value(count, magnitude);
+        }
+    }
+    // rounding in the vector code escaped a point that only just stays inside here
+    return escaped_value(count, 4.0);
+}
+
+typedef struct {
+    double zr[MAX_LANES];
+    double zi[MAX_LANES];
+    double cr[MAX_LANES];
+    double ci[MAX_LANES];
+    double iter[MAX_LANES];
+    double saved_r[MAX_LANES];      // orbit point remembered for cycle detection
+    double saved_i[MAX_LANES];
+    double next_save[MAX_LANES];    // iteration at which saved_r/saved_i move on
+    double block_zr[MAX_LANES];     // z at the start of the last block, see lane_escape_value()
+    double block_zi[MAX_LANES];
+    int pixel[MAX_LANES];
+    int next;
+    int busy;
+    int skipped;
+    
+    int* out;
+    int first;
+    int stride;
+    int count;
+    Complex origin;
+    Complex step;
+    int is_julia;
+    Complex julia_c;
+    int max_iterations;
+} SpanLanes;
+
+LANE_HELPER void fill_lane(SpanLanes* lanes, int lane) {
+    // pixels inside the cardioid or period-2 bulb are answered without ever entering a lane
+    while (!lanes->is_julia && lanes->next < lanes->count) {
+        int index = lanes->first + lanes->next * lanes->stride;
+        Complex c = {lanes->origin.real + index * lanes->step.real,
+                     lanes->origin.imag + index * lanes->step.imag};
+        if (!in_main_cardioid_or_bulb(c)) {
+            break;
+        }
+        lanes->out[lanes->next++] = interior_escape_value(lanes->max_iterations);
+        lanes->skipped++;
+    }
+    
+    if (lanes->next < lanes->count) {
+        int index = lanes->first + lanes->next * lanes->stride;
+        double real = lanes->origin.real + index * lanes->step.real;
+        double imag = lanes->origin.imag + index * lanes->step.imag;
+        lanes->zr[lane] = lanes->is_julia ? real : 0.0;
+        lanes->zi[lane] = lanes->is_julia ? imag : 0.0;
+        lanes->cr[lane] = lanes->is_julia ? lanes->julia_c.real : real;
+        lanes->ci[lane] = lanes->is_julia ? lanes->julia_c.imag : imag;
+        lanes->iter[lane] = 0.0;
+        lanes->saved_r[lane] = lanes->zr[lane];
+        lanes->saved_i[lane] = lanes->zi[lane];
+        lanes->next_save[lane] = 2 * ITERATION_BLOCK;
+        lanes->pixel[lane] = lanes->next++;
+    } else {
+        lanes->zr[lane] = lanes->zi[lane] = lanes->cr[lane] = lanes->ci[lane] = 0.0;
+        lanes->iter[lane] = IDLE_ITERATIONS;
+        lanes->saved_r[lane] = lanes->saved_i[lane] = 1.0;
+        lanes->next_save[lane] = 0.0;
+        lanes->pixel[lane] = -1;
+        lanes->busy--;
+    }
+}
+
+LANE_HELPER void init_lanes(SpanLanes* lanes, int lane_count, int* out, int first, int stride,
+                            int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                            int max_iterations) {
+    lanes->next = 0;
+    lanes->busy = lane_count;
+    lanes->skipped = 0;
+    lanes->out = out;
+    lanes->first = first;
+    lanes->stride = stride;
+    lanes->count = count;
+    lanes->origin = origin;
+    lanes->step = step;
+    lanes->is_julia = is_julia;
+    lanes->julia_c = julia_c;
+    lanes->max_iterations = max_iterations;
+    for (int lane = 0; lane < lane_count; lane++) {
+        fill_lane(lanes, lane);
+    }
+}
+
+// writes out the result of every lane in done_mask and refills it
+LANE_HELPER void retire_lanes(SpanLanes* lanes, int lane_count, int done_mask) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (done_mask & (1 << lane)) {
+            lanes->out[lanes->pixel[lane]] = lane_escape_value((int)lanes->iter[lane], lanes->max_iterations,
+                                                               lanes->block_zr[lane], lanes->block_zi[lane],
+                                                               lanes->cr[lane], lanes->ci[lane]);
+            fill_lane(lanes, lane);
+        }
+    }
+}
+
+#define SSE2_LANES 2
+#define AVX_LANES 4
+#define AVX2_LANES 4
+#define AVX512_LANES 8
+
+__attribute__((target("sse2")))
+int escape_span_sse2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                     int max_iterations) {
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d limit = _mm_set1_pd(max_iterations);
+    const __m128d epsilon = _mm_set1_pd(PERIODICITY_EPSILON);
+    const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m128d all_lanes = _mm_cmpeq_pd(one, one);
+    
+    SpanLanes lanes;
+    init_lanes(&lanes, SSE2_LANES, out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m128d zr = _mm_loadu_pd(lanes.zr);
+        __m128d zi = _mm_loadu_pd(lanes.zi);
+        __m128d cr = _mm_loadu_pd(lanes.cr);
+        __m128d ci = _mm_loadu_pd(lanes.ci);
+        __m128d iter = _mm_loadu_pd(lanes.iter);
+        __m128d saved_r = _mm_loadu_pd(lanes.saved_r);
+        __m128d saved_i = _mm_loadu_pd(lanes.saved_i);
+        __m128d next_save = _mm_loadu_pd(lanes.next_save);
+        __m128d active = all_lanes;
+        __m128d block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m128d zr2 = _mm_mul_pd(zr, zr);
+                __m128d zi2 = _mm_mul_pd(zi, zi);
+                __m128d new_zi = _mm_add_pd(_mm_mul_pd(_mm_add_pd(zr, zr), zi), ci);
+                zr = _mm_add_pd(_mm_sub_pd(zr2, zi2), cr);
+                zi = new_zi;
+                
+                __m128d magnitude = _mm_add_pd(_mm_mul_pd(zr, zr), _mm_mul_pd(zi, zi));
+                active = _mm_and_pd(active, _mm_cmple_pd(magnitude, four));
+                iter = _mm_add_pd(iter, _mm_and_pd(active, one));
+            }
+            iter = _mm_min_pd(iter, limit);
+            active = _mm_and_pd(active, _mm_cmplt_pd(iter, limit));
+            
+            __m128d cycled = _mm_and_pd(active, _mm_and_pd(
+                _mm_cmplt_pd(_mm_and_pd(_mm_sub_pd(zr, saved_r), abs_mask), epsilon),
+                _mm_cmplt_pd(_mm_and_pd(_mm_sub_pd(zi, saved_i), abs_mask), epsilon)));
+            iter = _mm_or_pd(_mm_and_pd(cycled, limit), _mm_andnot_pd(cycled, iter));
+            
+            __m128d save = _mm_and_pd(active, _mm_cmpeq_pd(iter, next_save));
+            saved_r = _mm_or_pd(_mm_and_pd(save, zr), _mm_andnot_pd(save, saved_r));
+            saved_i = _mm_or_pd(_mm_and_pd(save, zi), _mm_andnot_pd(save, saved_i));
+            next_save = _mm_add_pd(next_save, _mm_and_pd(save, next_save));
+            
+            done = _mm_movemask_pd(_mm_or_pd(cycled, _mm_xor_pd(active, all_lanes)));
+        } while (!done);
+        
+        _mm_storeu_pd(lanes.zr, zr);
+        _mm_storeu_pd(lanes.zi, zi);
+        _mm_storeu_pd(lanes.block_zr, block_zr);
+        _mm_storeu_pd(lanes.block_zi, block_zi);
+        _mm_storeu_pd(lanes.iter, iter);
+        _mm_storeu_pd(lanes.saved_r, saved_r);
+        _mm_storeu_pd(lanes.saved_i, saved_i);
+        _mm_storeu_pd(lanes.next_save, next_save);
+        retire_lanes(&lanes, SSE2_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx")))
+int escape_span_avx(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                    int max_iterations) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d limit = _mm256_set1_pd(max_iterations);
+    const __m256d epsilon = _mm256_set1_pd(PERIODICITY_EPSILON);
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m256d all_lanes = _mm256_cmp_pd(one, one, _CMP_EQ_OQ);
+    
+    SpanLanes lanes;
+    init_lanes(&lanes, AVX_LANES, out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m256d zr = _mm256_loadu_pd(lanes.zr);
+        __m256d zi = _mm256_loadu_pd(lanes.zi);
+        __m256d cr = _mm256_loadu_pd(lanes.cr);
+        __m256d ci = _mm256_loadu_pd(lanes.ci);
+        __m256d iter = _mm256_loadu_pd(lanes.iter);
+        __m256d saved_r = _mm256_loadu_pd(lanes.saved_r);
+        __m256d saved_i = _mm256_loadu_pd(lanes.saved_i);
+        __m256d next_save = _mm256_loadu_pd(lanes.next_save);
+        __m256d active = all_lanes;
+        __m256d block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m256d zr2 = _mm256_mul_pd(zr, zr);
+                __m256d zi2 = _mm256_mul_pd(zi, zi);
+                __m256d new_zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+                zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+                zi = new_zi;
+                
+                __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zr, zr), _mm256_mul_pd(zi, zi));
+                active = _mm256_and_pd(active, _mm256_cmp_pd(magnitude, four, _CMP_LE_OQ));
+                iter = _mm256_add_pd(iter, _mm256_and_pd(active, one));
+            }
+            iter = _mm256_min_pd(iter, limit);
+            active = _mm256_and_pd(active, _mm256_cmp_pd(iter, limit, _CMP_LT_OQ));
+            
+            __m256d cycled = _mm256_and_pd(active, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(zr, saved_r), abs_mask), epsilon, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(zi, saved_i), abs_mask), epsilon, _CMP_LT_OQ)));
+            iter = _mm256_blendv_pd(iter, limit, cycled);
+            
+            __m256d save = _mm256_and_pd(active, _mm256_cmp_pd(iter, next_save, _CMP_EQ_OQ));
+            saved_r = _mm256_blendv_pd(saved_r, zr, save);
+            saved_i = _mm256_blendv_pd(saved_i, zi, save);
+            next_save = _mm256_add_pd(next_save, _mm256_and_pd(save, next_save));
+            
+            done = _mm256_movemask_pd(_mm256_or_pd(cycled, _mm256_xor_pd(active, all_lanes)));
+        } while (!done);
+        
+        _mm256_storeu_pd(lanes.zr, zr);
+        _mm256_storeu_pd(lanes.zi, zi);
+        _mm256_storeu_pd(lanes.block_zr, block_zr);
+        _mm256_storeu_pd(lanes.block_zi, block_zi);
+        _mm256_storeu_pd(lanes.iter, iter);
+        _mm256_storeu_pd(lanes.saved_r, saved_r);
+        _mm256_storeu_pd(lanes.saved_i, saved_i);
+        _mm256_storeu_pd(lanes.next_save, next_save);
+        retire_lanes(&lanes, AVX_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx2,fma")))
+int escape_span_avx2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                     int max_iterations) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d limit = _mm256_set1_pd(max_iterations);
+    const __m256d epsilon = _mm256_set1_pd(PERIODICITY_EPSILON);
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m256d all_lanes = _mm256_cmp_pd(one, one, _CMP_EQ_OQ);
+    
+    SpanLanes lanes;
+    init_lanes(&lanes, AVX2_LANES, out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m256d zr = _mm256_loadu_pd(lanes.zr);
+        __m256d zi = _mm256_loadu_pd(lanes.zi);
+        __m256d cr = _mm256_loadu_pd(lanes.cr);
+        __m256d ci = _mm256_loadu_pd(lanes.ci);
+        __m256d iter = _mm256_loadu_pd(lanes.iter);
+        __m256d saved_r = _mm256_loadu_pd(lanes.saved_r);
+        __m256d saved_i = _mm256_loadu_pd(lanes.saved_i);
+        __m256d next_save = _mm256_loadu_pd(lanes.next_save);
+        __m256d active = all_lanes;
+        __m256d block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m256d new_zr = _mm256_fmsub_pd(zr, zr, _mm256_fmsub_pd(zi, zi, cr));
+                __m256d new_zi = _mm256_fmadd_pd(_mm256_add_pd(zr, zr), zi, ci);
+                zr = new_zr;
+                zi = new_zi;
+                
+                __m256d magnitude = _mm256_fmadd_pd(zr, zr, _mm256_mul_pd(zi, zi));
+                active = _mm256_and_pd(active, _mm256_cmp_pd(magnitude, four, _CMP_LE_OQ));
+                iter = _mm256_add_pd(iter, _mm256_and_pd(active, one));
+            }
+            iter = _mm256_min_pd(iter, limit);
+            active = _mm256_and_pd(active, _mm256_cmp_pd(iter, limit, _CMP_LT_OQ));
+            
+            __m256d cycled = _mm256_and_pd(active, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(zr, saved_r), abs_mask), epsilon, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(zi, saved_i), abs_mask), epsilon, _CMP_LT_OQ)));
+            iter = _mm256_blendv_pd(iter, limit, cycled);
+            
+            __m256d save = _mm256_and_pd(active, _mm256_cmp_pd(iter, next_save, _CMP_EQ_OQ));
+            saved_r = _mm256_blendv_pd(saved_r, zr, save);
+            saved_i = _mm256_blendv_pd(saved_i, zi, save);
+            next_save = _mm256_add_pd(next_save, _mm256_and_pd(save, next_save));
+            
+            done = _mm256_movemask_pd(_mm256_or_pd(cycled, _mm256_xor_pd(active, all_lanes)));
+        } while (!done);
+        
+        _mm256_storeu_pd(lanes.zr, zr);
+        _mm256_storeu_pd(lanes.zi, zi);
+        _mm256_storeu_pd(lanes.block_zr, block_zr);
+        _mm256_storeu_pd(lanes.block_zi, block_zi);
+        _mm256_storeu_pd(lanes.iter, iter);
+        _mm256_storeu_pd(lanes.saved_r, saved_r);
+        _mm256_storeu_pd(lanes.saved_i, saved_i);
+        _mm256_storeu_pd(lanes.next_save, next_save);
+        retire_lanes(&lanes, AVX2_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx512f")))
+int escape_span_avx512(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                       int max_iterations) {
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d limit = _mm512_set1_pd(max_iterations);
+    const __m512d epsilon = _mm512_set1_pd(PERIODICITY_EPSILON);
+    
+    SpanLanes lanes;
+    init_lanes(&lanes, AVX512_LANES, out, first, stride, count, origin, step, is_julia, julia_c, max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m512d zr = _mm512_loadu_pd(lanes.zr);
+        __m512d zi = _mm512_loadu_pd(lanes.zi);
+        __m512d cr = _mm512_loadu_pd(lanes.cr);
+        __m512d ci = _mm512_loadu_pd(lanes.ci);
+        __m512d iter = _mm512_loadu_pd(lanes.iter);
+        __m512d saved_r = _mm512_loadu_pd(lanes.saved_r);
+        __m512d saved_i = _mm512_loadu_pd(lanes.saved_i);
+        __m512d next_save = _mm512_loadu_pd(lanes.next_save);
+        __mmask8 active = 0xFF;
+        __m512d block_zr, block_zi;
+        __mmask8 done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m512d new_zr = _mm512_fmsub_pd(zr, zr, _mm512_fmsub_pd(zi, zi, cr));
+                __m512d new_zi = _mm512_fmadd_pd(_mm512_add_pd(zr, zr), zi, ci);
+                zr = new_zr;
+                zi = new_zi;
+                
+                __m512d magnitude = _mm512_fmadd_pd(zr, zr, _mm512_mul_pd(zi, zi));
+                active &= _mm512_cmp_pd_mask(magnitude, four, _CMP_LE_OQ);
+                iter = _mm512_mask_add_pd(iter, active, iter, one);
+            }
+            iter = _mm512_min_pd(iter, limit);
+            active &= _mm512_cmp_pd_mask(iter, limit, _CMP_LT_OQ);
+            
+            __mmask8 cycled = active &
+                _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zr, saved_r)), epsilon, _CMP_LT_OQ) &
+                _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zi, saved_i)), epsilon, _CMP_LT_OQ);
+            iter = _mm512_mask_mov_pd(iter, cycled, limit);
+            
+            __mmask8 save = active & _mm512_cmp_pd_mask(iter, next_save, _CMP_EQ_OQ);
+            saved_r = _mm512_mask_mov_pd(saved_r, save, zr);
+            saved_i = _mm512_mask_mov_pd(saved_i, save, zi);
+            next_save = _mm512_mask_add_pd(next_save, save, next_save, next_save);
+            
+            done = cycled | (__mmask8)~active;
+        } while (!done);
+        
+        _mm512_storeu_pd(lanes.zr, zr);
+        _mm512_storeu_pd(lanes.zi, zi);
+        _mm512_storeu_pd(lanes.block_zr, block_zr);
+        _mm512_storeu_pd(lanes.block_zi, block_zi);
+        _mm512_storeu_pd(lanes.iter, iter);
+        _mm512_storeu_pd(lanes.saved_r, saved_r);
+        _mm512_storeu_pd(lanes.saved_i, saved_i);
+        _mm512_storeu_pd(lanes.next_save, next_save);
+        retire_lanes(&lanes, AVX512_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+// Double-double lanes: the same refill scheme with every coordinate split
+// into a hi and a lo part, see double_double.h. Without cycle detection and
+// the cardioid test, which only work in plain double.
+typedef struct {
+    double zr_hi[MAX_LANES];
+    double zr_lo[MAX_LANES];
+    double zi_hi[MAX_LANES];
+    double zi_lo[MAX_LANES];
+    double cr_hi[MAX_LANES];
+    double cr_lo[MAX_LANES];
+    double ci_hi[MAX_LANES];
+    double ci_lo[MAX_LANES];
+    double iter[MAX_LANES];
+    double block_zr[MAX_LANES];     // hi parts only
+    double block_zi[MAX_LANES];
+    int pixel[MAX_LANES];
+    int next;
+    int busy;
+    
+    int* out;
+    int first;
+    int stride;
+    int count;
+    Complex origin;
+    Complex origin_low;
+    Complex step;
+    int is_julia;
+    Complex julia_c;
+    int max_iterations;
+} DDSpanLanes;
+
+LANE_HELPER void fill_dd_lane(DDSpanLanes* lanes, int lane) {
+    if (lanes->next < lanes->count) {
+        int index = lanes->first + lanes->next * lanes->stride;
+        DoubleDouble real = two_sum(lanes->origin.real, index * lanes->step.real);
+        DoubleDouble imag = two_sum(lanes->origin.imag, index * lanes->step.imag);
+        real = fast_two_sum(real.hi, real.lo + lanes->origin_low.real);
+        imag = fast_two_sum(imag.hi, imag.lo + lanes->origin_low.imag);
+        
+        DoubleDouble zero = {0.0, 0.0};
+        DoubleDouble julia_real = {lanes->julia_c.real, 0.0};
+        DoubleDouble julia_imag = {lanes->julia_c.imag, 0.0};
+        DoubleDouble zr = lanes->is_julia ? real : zero;
+        DoubleDouble zi = lanes->is_julia ? imag : zero;
+        DoubleDouble cr = lanes->is_julia ? julia_real : real;
+        DoubleDouble ci = lanes->is_julia ? julia_imag : imag;
+        lanes->zr_hi[lane] = zr.hi;
+        lanes->zr_lo[lane] = zr.lo;
+        lanes->zi_hi[lane] = zi.hi;
+        lanes->zi_lo[lane] = zi.lo;
+        lanes->cr_hi[lane] = cr.hi;
+        lanes->cr_lo[lane] = cr.lo;
+        lanes->ci_hi[lane] = ci.hi;
+        lanes->ci_lo[lane] = ci.lo;
+        lanes->iter[lane] = 0.0;
+        lanes->pixel[lane] = lanes->next++;
+    } else {
+        lanes->zr_hi[lane] = lanes->zr_lo[lane] = lanes->zi_hi[lane] = lanes->zi_lo[lane] = 0.0;
+        lanes->cr_hi[lane] = lanes->cr_lo[lane] = lanes->ci_hi[lane] = lanes->ci_lo[lane] = 0.0;
+        lanes->iter[lane] = IDLE_ITERATIONS;
+        lanes->pixel[lane] = -1;
+        lanes->busy--;
+    }
+}
+
+LANE_HELPER void init_dd_lanes(DDSpanLanes* lanes, int lane_count, int* out, int first, int stride,
+                               int count, Complex origin, Complex origin_low, Complex step,
+                               int is_julia, Complex julia_c, int max_iterations) {
+    lanes->next = 0;
+    lanes->busy = lane_count;
+    lanes->out = out;
+    lanes->first = first;
+    lanes->stride = stride;
+    lanes->count = count;
+    lanes->origin = origin;
+    lanes->origin_low = origin_low;
+    lanes->step = step;
+    lanes->is_julia = is_julia;
+    lanes->julia_c = julia_c;
+    lanes->max_iterations = max_iterations;
+    for (int lane = 0; lane < lane_count; lane++) {
+        fill_dd_lane(lanes, lane);
+    }
+}
+
+LANE_HELPER void retire_dd_lanes(DDSpanLanes* lanes, int lane_count, int done_mask) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (done_mask & (1 << lane)) {
+            lanes->out[lanes->pixel[lane]] = lane_escape_value((int)lanes->iter[lane], lanes->max_iterations,
+                                                               lanes->block_zr[lane], lanes->block_zi[lane],
+                                                               lanes->cr_hi[lane], lanes->ci_hi[lane]);
+            fill_dd_lane(lanes, lane);
+        }
+    }
+}
+
+#define AVX2_HELPER static inline __attribute__((target("avx2,fma"), always_inline))
+
+AVX2_HELPER void fast_two_sum_avx2(__m256d a, __m256d b, __m256d* hi, __m256d* lo) {
+    *hi = _mm256_add_pd(a, b);
+    *lo = _mm256_sub_pd(b, _mm256_sub_pd(*hi, a));
+}
+
+AVX2_HELPER void dd_add_avx2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo,
+                             __m256d* hi, __m256d* lo) {
+    __m256d sum = _mm256_add_pd(a_hi, b_hi);
+    __m256d b_part = _mm256_sub_pd(sum, a_hi);
+    __m256d error = _mm256_add_pd(_mm256_sub_pd(a_hi, _mm256_sub_pd(sum, b_part)),
+                                  _mm256_sub_pd(b_hi, b_part));
+    fast_two_sum_avx2(sum, _mm256_add_pd(error, _mm256_add_pd(a_lo, b_lo)), hi, lo);
+}
+
+AVX2_HELPER void dd_mul_avx2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo,
+                             __m256d* hi, __m256d* lo) {
+    __m256d product = _mm256_mul_pd(a_hi, b_hi);
+    __m256d error = _mm256_fmsub_pd(a_hi, b_hi, product);
+    error = _mm256_fmadd_pd(a_hi, b_lo, _mm256_fmadd_pd(a_lo, b_hi, error));
+    fast_two_sum_avx2(product, error, hi, lo);
+}
+
+__attribute__((target("avx2,fma")))
+int escape_span_dd_avx2(int* out, int first, int stride, int count, Complex origin, Complex origin_low,
+                        Complex step, int is_julia, Complex julia_c, int max_iterations) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d limit = _mm256_set1_pd(max_iterations);
+    const __m256d all_lanes = _mm256_cmp_pd(one, one, _CMP_EQ_OQ);
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    
+    DDSpanLanes lanes;
+    init_dd_lanes(&lanes, AVX2_LANES, out, first, stride, count, origin, origin_low, step, is_julia, julia_c,
+                  max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m256d zr_hi = _mm256_loadu_pd(lanes.zr_hi);
+        __m256d zr_lo = _mm256_loadu_pd(lanes.zr_lo);
+        __m256d zi_hi = _mm256_loadu_pd(lanes.zi_hi);
+        __m256d zi_lo = _mm256_loadu_pd(lanes.zi_lo);
+        __m256d cr_hi = _mm256_loadu_pd(lanes.cr_hi);
+        __m256d cr_lo = _mm256_loadu_pd(lanes.cr_lo);
+        __m256d ci_hi = _mm256_loadu_pd(lanes.ci_hi);
+        __m256d ci_lo = _mm256_loadu_pd(lanes.ci_lo);
+        __m256d iter = _mm256_loadu_pd(lanes.iter);
+        __m256d active = all_lanes;
+        __m256d block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr_hi;
+            block_zi = zi_hi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c, as zr^2 + (-zi^2) + cr and 2 zr zi + ci
+                __m256d real_hi, real_lo, imag_hi, imag_lo, cross_hi, cross_lo;
+                dd_mul_avx2(zr_hi, zr_lo, zr_hi, zr_lo, &real_hi, &real_lo);
+                dd_mul_avx2(zi_hi, zi_lo, zi_hi, zi_lo, &imag_hi, &imag_lo);
+                dd_mul_avx2(zr_hi, zr_lo, zi_hi, zi_lo, &cross_hi, &cross_lo);
+                dd_add_avx2(real_hi, real_lo, _mm256_xor_pd(imag_hi, sign_mask),
+                            _mm256_xor_pd(imag_lo, sign_mask), &real_hi, &real_lo);
+                dd_add_avx2(real_hi, real_lo, cr_hi, cr_lo, &zr_hi, &zr_lo);
+                dd_add_avx2(_mm256_add_pd(cross_hi, cross_hi), _mm256_add_pd(cross_lo, cross_lo),
+                            ci_hi, ci_lo, &zi_hi, &zi_lo);
+                
+                __m256d magnitude = _mm256_fmadd_pd(zr_hi, zr_hi, _mm256_mul_pd(zi_hi, zi_hi));
+                active = _mm256_and_pd(active, _mm256_cmp_pd(magnitude, four, _CMP_LE_OQ));
+                iter = _mm256_add_pd(iter, _mm256_and_pd(active, one));
+            }
+            iter = _mm256_min_pd(iter, limit);
+            active = _mm256_and_pd(active, _mm256_cmp_pd(iter, limit, _CMP_LT_OQ));
+            done = _mm256_movemask_pd(_mm256_xor_pd(active, all_lanes));
+        } while (!done);
+        
+        _mm256_storeu_pd(lanes.zr_hi, zr_hi);
+        _mm256_storeu_pd(lanes.zr_lo, zr_lo);
+        _mm256_storeu_pd(lanes.zi_hi, zi_hi);
+        _mm256_storeu_pd(lanes.block_zr, block_zr);
+        _mm256_storeu_pd(lanes.block_zi, block_zi);
+        _mm256_storeu_pd(lanes.zi_lo, zi_lo);
+        _mm256_storeu_pd(lanes.iter, iter);
+        retire_dd_lanes(&lanes, AVX2_LANES, done);
+    }
+    return 0;
+}
+
+// Single-precision lanes: the same refill scheme at twice the width. Points
+// are still placed in double and only rounded to float on the way into the
+// lane, so neighbouring pixels never collapse onto one coordinate.
+#define FLOAT_MAX_LANES 16
+#define SSE2_FLOAT_LANES 4
+#define AVX_FLOAT_LANES 8
+#define AVX2_FLOAT_LANES 8
+#define AVX512_FLOAT_LANES 16
+
+typedef struct {
+    float zr[FLOAT_MAX_LANES];
+    float zi[FLOAT_MAX_LANES];
+    float cr[FLOAT_MAX_LANES];
+    float ci[FLOAT_MAX_LANES];
+    float iter[FLOAT_MAX_LANES];
+    float saved_r[FLOAT_MAX_LANES];
+    float saved_i[FLOAT_MAX_LANES];
+    float next_save[FLOAT_MAX_LANES];
+    float block_zr[FLOAT_MAX_LANES];
+    float block_zi[FLOAT_MAX_LANES];
+    int pixel[FLOAT_MAX_LANES];
+    int next;
+    int busy;
+    int skipped;
+    
+    int* out;
+    int first;
+    int stride;
+    int count;
+    Complex origin;
+    Complex step;
+    int is_julia;
+    Complex julia_c;
+    int max_iterations;
+} FloatSpanLanes;
+
+LANE_HELPER void fill_float_lane(FloatSpanLanes* lanes, int lane) {
+    while (!lanes->is_julia && lanes->next < lanes->count) {
+        int index = lanes->first + lanes->next * lanes->stride;
+        Complex c = {lanes->origin.real + index * lanes->step.real,
+                     lanes->origin.imag + index * lanes->step.imag};
+        if (!in_main_cardioid_or_bulb(c)) {
+            break;
+        }
+        lanes->out[lanes->next++] = interior_escape_value(lanes->max_iterations);
+        lanes->skipped++;
+    }
+    
+    if (lanes->next < lanes->count) {
+        int index = lanes->first + lanes->next * lanes->stride;
+        float real = (float)(lanes->origin.real + index * lanes->step.real);
+        float imag = (float)(lanes->origin.imag + index * lanes->step.imag);
+        lanes->zr[lane] = lanes->is_julia ? real : 0.0f;
+        lanes->zi[lane] = lanes->is_julia ? imag : 0.0f;
+        lanes->cr[lane] = lanes->is_julia ? (float)lanes->julia_c.real : real;
+        lanes->ci[lane] = lanes->is_julia ? (float)lanes->julia_c.imag : imag;
+        lanes->iter[lane] = 0.0f;
+        lanes->saved_r[lane] = lanes->zr[lane];
+        lanes->saved_i[lane] = lanes->zi[lane];
+        lanes->next_save[lane] = 2 * ITERATION_BLOCK;
+        lanes->pixel[lane] = lanes->next++;
+    } else {
+        lanes->zr[lane] = lanes->zi[lane] = lanes->cr[lane] = lanes->ci[lane] = 0.0f;
+        lanes->iter[lane] = (float)IDLE_ITERATIONS;
+        lanes->saved_r[lane] = lanes->saved_i[lane] = 1.0f;
+        lanes->next_save[lane] = 0.0f;
+        lanes->pixel[lane] = -1;
+        lanes->busy--;
+    }
+}
+
+LANE_HELPER void init_float_lanes(FloatSpanLanes* lanes, int lane_count, int* out, int first, int stride,
+                                  int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                                  int max_iterations) {
+    lanes->next = 0;
+    lanes->busy = lane_count;
+    lanes->skipped = 0;
+    lanes->out = out;
+    lanes->first = first;
+    lanes->stride = stride;
+    lanes->count = count;
+    lanes->origin = origin;
+    lanes->step = step;
+    lanes->is_julia = is_julia;
+    lanes->julia_c = julia_c;
+    lanes->max_iterations = max_iterations;
+    for (int lane = 0; lane < lane_count; lane++) {
+        fill_float_lane(lanes, lane);
+    }
+}
+
+LANE_HELPER void retire_float_lanes(FloatSpanLanes* lanes, int lane_count, int done_mask) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (done_mask & (1 << lane)) {
+            lanes->out[lanes->pixel[lane]] = lane_escape_value((int)lanes->iter[lane], lanes->max_iterations,
+                                                               lanes->block_zr[lane], lanes->block_zi[lane],
+                                                               lanes->cr[lane], lanes->ci[lane]);
+            fill_float_lane(lanes, lane);
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+int escape_span_float_sse2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                           int max_iterations) {
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 limit = _mm_set1_ps(max_iterations);
+    const __m128 epsilon = _mm_set1_ps(FLOAT_PERIODICITY_EPSILON);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 all_lanes = _mm_cmpeq_ps(one, one);
+    
+    FloatSpanLanes lanes;
+    init_float_lanes(&lanes, SSE2_FLOAT_LANES, out, first, stride, count, origin, step, is_julia, julia_c,
+                     max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m128 zr = _mm_loadu_ps(lanes.zr);
+        __m128 zi = _mm_loadu_ps(lanes.zi);
+        __m128 cr = _mm_loadu_ps(lanes.cr);
+        __m128 ci = _mm_loadu_ps(lanes.ci);
+        __m128 iter = _mm_loadu_ps(lanes.iter);
+        __m128 saved_r = _mm_loadu_ps(lanes.saved_r);
+        __m128 saved_i = _mm_loadu_ps(lanes.saved_i);
+        __m128 next_save = _mm_loadu_ps(lanes.next_save);
+        __m128 active = all_lanes;
+        __m128 block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m128 zr2 = _mm_mul_ps(zr, zr);
+                __m128 zi2 = _mm_mul_ps(zi, zi);
+                __m128 new_zi = _mm_add_ps(_mm_mul_ps(_mm_add_ps(zr, zr), zi), ci);
+                zr = _mm_add_ps(_mm_sub_ps(zr2, zi2), cr);
+                zi = new_zi;
+                
+                __m128 magnitude = _mm_add_ps(_mm_mul_ps(zr, zr), _mm_mul_ps(zi, zi));
+                active = _mm_and_ps(active, _mm_cmple_ps(magnitude, four));
+                iter = _mm_add_ps(iter, _mm_and_ps(active, one));
+            }
+            iter = _mm_min_ps(iter, limit);
+            active = _mm_and_ps(active, _mm_cmplt_ps(iter, limit));
+            
+            __m128 cycled = _mm_and_ps(active, _mm_and_ps(
+                _mm_cmplt_ps(_mm_and_ps(_mm_sub_ps(zr, saved_r), abs_mask), epsilon),
+                _mm_cmplt_ps(_mm_and_ps(_mm_sub_ps(zi, saved_i), abs_mask), epsilon)));
+            iter = _mm_or_ps(_mm_and_ps(cycled, limit), _mm_andnot_ps(cycled, iter));
+            
+            __m128 save = _mm_and_ps(active, _mm_cmpeq_ps(iter, next_save));
+            saved_r = _mm_or_ps(_mm_and_ps(save, zr), _mm_andnot_ps(save, saved_r));
+            saved_i = _mm_or_ps(_mm_and_ps(save, zi), _mm_andnot_ps(save, saved_i));
+            next_save = _mm_add_ps(next_save, _mm_and_ps(save, next_save));
+            
+            done = _mm_movemask_ps(_mm_or_ps(cycled, _mm_xor_ps(active, all_lanes)));
+        } while (!done);
+        
+        _mm_storeu_ps(lanes.zr, zr);
+        _mm_storeu_ps(lanes.zi, zi);
+        _mm_storeu_ps(lanes.block_zr, block_zr);
+        _mm_storeu_ps(lanes.block_zi, block_zi);
+        _mm_storeu_ps(lanes.iter, iter);
+        _mm_storeu_ps(lanes.saved_r, saved_r);
+        _mm_storeu_ps(lanes.saved_i, saved_i);
+        _mm_storeu_ps(lanes.next_save, next_save);
+        retire_float_lanes(&lanes, SSE2_FLOAT_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx")))
+int escape_span_float_avx(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                          int max_iterations) {
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 limit = _mm256_set1_ps(max_iterations);
+    const __m256 epsilon = _mm256_set1_ps(FLOAT_PERIODICITY_EPSILON);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 all_lanes = _mm256_cmp_ps(one, one, _CMP_EQ_OQ);
+    
+    FloatSpanLanes lanes;
+    init_float_lanes(&lanes, AVX_FLOAT_LANES, out, first, stride, count, origin, step, is_julia, julia_c,
+                     max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m256 zr = _mm256_loadu_ps(lanes.zr);
+        __m256 zi = _mm256_loadu_ps(lanes.zi);
+        __m256 cr = _mm256_loadu_ps(lanes.cr);
+        __m256 ci = _mm256_loadu_ps(lanes.ci);
+        __m256 iter = _mm256_loadu_ps(lanes.iter);
+        __m256 saved_r = _mm256_loadu_ps(lanes.saved_r);
+        __m256 saved_i = _mm256_loadu_ps(lanes.saved_i);
+        __m256 next_save = _mm256_loadu_ps(lanes.next_save);
+        __m256 active = all_lanes;
+        __m256 block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m256 zr2 = _mm256_mul_ps(zr, zr);
+                __m256 zi2 = _mm256_mul_ps(zi, zi);
+                __m256 new_zi = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(zr, zr), zi), ci);
+                zr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+                zi = new_zi;
+                
+                __m256 magnitude = _mm256_add_ps(_mm256_mul_ps(zr, zr), _mm256_mul_ps(zi, zi));
+                active = _mm256_and_ps(active, _mm256_cmp_ps(magnitude, four, _CMP_LE_OQ));
+                iter = _mm256_add_ps(iter, _mm256_and_ps(active, one));
+            }
+            iter = _mm256_min_ps(iter, limit);
+            active = _mm256_and_ps(active, _mm256_cmp_ps(iter, limit, _CMP_LT_OQ));
+            
+            __m256 cycled = _mm256_and_ps(active, _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(zr, saved_r), abs_mask), epsilon, _CMP_LT_OQ),
+                _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(zi, saved_i), abs_mask), epsilon, _CMP_LT_OQ)));
+            iter = _mm256_blendv_ps(iter, limit, cycled);
+            
+            __m256 save = _mm256_and_ps(active, _mm256_cmp_ps(iter, next_save, _CMP_EQ_OQ));
+            saved_r = _mm256_blendv_ps(saved_r, zr, save);
+            saved_i = _mm256_blendv_ps(saved_i, zi, save);
+            next_save = _mm256_add_ps(next_save, _mm256_and_ps(save, next_save));
+            
+            done = _mm256_movemask_ps(_mm256_or_ps(cycled, _mm256_xor_ps(active, all_lanes)));
+        } while (!done);
+        
+        _mm256_storeu_ps(lanes.zr, zr);
+        _mm256_storeu_ps(lanes.zi, zi);
+        _mm256_storeu_ps(lanes.block_zr, block_zr);
+        _mm256_storeu_ps(lanes.block_zi, block_zi);
+        _mm256_storeu_ps(lanes.iter, iter);
+        _mm256_storeu_ps(lanes.saved_r, saved_r);
+        _mm256_storeu_ps(lanes.saved_i, saved_i);
+        _mm256_storeu_ps(lanes.next_save, next_save);
+        retire_float_lanes(&lanes, AVX_FLOAT_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx2,fma")))
+int escape_span_float_avx2(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                           int max_iterations) {
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 limit = _mm256_set1_ps(max_iterations);
+    const __m256 epsilon = _mm256_set1_ps(FLOAT_PERIODICITY_EPSILON);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 all_lanes = _mm256_cmp_ps(one, one, _CMP_EQ_OQ);
+    
+    FloatSpanLanes lanes;
+    init_float_lanes(&lanes, AVX2_FLOAT_LANES, out, first, stride, count, origin, step, is_julia, julia_c,
+                     max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m256 zr = _mm256_loadu_ps(lanes.zr);
+        __m256 zi = _mm256_loadu_ps(lanes.zi);
+        __m256 cr = _mm256_loadu_ps(lanes.cr);
+        __m256 ci = _mm256_loadu_ps(lanes.ci);
+        __m256 iter = _mm256_loadu_ps(lanes.iter);
+        __m256 saved_r = _mm256_loadu_ps(lanes.saved_r);
+        __m256 saved_i = _mm256_loadu_ps(lanes.saved_i);
+        __m256 next_save = _mm256_loadu_ps(lanes.next_save);
+        __m256 active = all_lanes;
+        __m256 block_zr, block_zi;
+        int done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m256 new_zr = _mm256_fmsub_ps(zr, zr, _mm256_fmsub_ps(zi, zi, cr));
+                __m256 new_zi = _mm256_fmadd_ps(_mm256_add_ps(zr, zr), zi, ci);
+                zr = new_zr;
+                zi = new_zi;
+                
+                __m256 magnitude = _mm256_fmadd_ps(zr, zr, _mm256_mul_ps(zi, zi));
+                active = _mm256_and_ps(active, _mm256_cmp_ps(magnitude, four, _CMP_LE_OQ));
+                iter = _mm256_add_ps(iter, _mm256_and_ps(active, one));
+            }
+            iter = _mm256_min_ps(iter, limit);
+            active = _mm256_and_ps(active, _mm256_cmp_ps(iter, limit, _CMP_LT_OQ));
+            
+            __m256 cycled = _mm256_and_ps(active, _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(zr, saved_r), abs_mask), epsilon, _CMP_LT_OQ),
+                _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(zi, saved_i), abs_mask), epsilon, _CMP_LT_OQ)));
+            iter = _mm256_blendv_ps(iter, limit, cycled);
+            
+            __m256 save = _mm256_and_ps(active, _mm256_cmp_ps(iter, next_save, _CMP_EQ_OQ));
+            saved_r = _mm256_blendv_ps(saved_r, zr, save);
+            saved_i = _mm256_blendv_ps(saved_i, zi, save);
+            next_save = _mm256_add_ps(next_save, _mm256_and_ps(save, next_save));
+            
+            done = _mm256_movemask_ps(_mm256_or_ps(cycled, _mm256_xor_ps(active, all_lanes)));
+        } while (!done);
+        
+        _mm256_storeu_ps(lanes.zr, zr);
+        _mm256_storeu_ps(lanes.zi, zi);
+        _mm256_storeu_ps(lanes.block_zr, block_zr);
+        _mm256_storeu_ps(lanes.block_zi, block_zi);
+        _mm256_storeu_ps(lanes.iter, iter);
+        _mm256_storeu_ps(lanes.saved_r, saved_r);
+        _mm256_storeu_ps(lanes.saved_i, saved_i);
+        _mm256_storeu_ps(lanes.next_save, next_save);
+        retire_float_lanes(&lanes, AVX2_FLOAT_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+__attribute__((target("avx512f")))
+int escape_span_float_avx512(int* out, int first, int stride, int count, Complex origin, Complex step, int is_julia, Complex julia_c,
+                             int max_iterations) {
+    const __m512 four = _mm512_set1_ps(4.0f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 limit = _mm512_set1_ps(max_iterations);
+    const __m512 epsilon = _mm512_set1_ps(FLOAT_PERIODICITY_EPSILON);
+    
+    FloatSpanLanes lanes;
+    init_float_lanes(&lanes, AVX512_FLOAT_LANES, out, first, stride, count, origin, step, is_julia, julia_c,
+                     max_iterations);
+    
+    while (lanes.busy > 0) {
+        __m512 zr = _mm512_loadu_ps(lanes.zr);
+        __m512 zi = _mm512_loadu_ps(lanes.zi);
+        __m512 cr = _mm512_loadu_ps(lanes.cr);
+        __m512 ci = _mm512_loadu_ps(lanes.ci);
+        __m512 iter = _mm512_loadu_ps(lanes.iter);
+        __m512 saved_r = _mm512_loadu_ps(lanes.saved_r);
+        __m512 saved_i = _mm512_loadu_ps(lanes.saved_i);
+        __m512 next_save = _mm512_loadu_ps(lanes.next_save);
+        __mmask16 active = 0xFFFF;
+        __m512 block_zr, block_zi;
+        __mmask16 done;
+        
+        do {
+            block_zr = zr;
+            block_zi = zi;
+            for (int k = 0; k < ITERATION_BLOCK; k++) {
+                // z = z * z + c
+                __m512 new_zr = _mm512_fmsub_ps(zr, zr, _mm512_fmsub_ps(zi, zi, cr));
+                __m512 new_zi = _mm512_fmadd_ps(_mm512_add_ps(zr, zr), zi, ci);
+                zr = new_zr;
+                zi = new_zi;
+                
+                __m512 magnitude = _mm512_fmadd_ps(zr, zr, _mm512_mul_ps(zi, zi));
+                active &= _mm512_cmp_ps_mask(magnitude, four, _CMP_LE_OQ);
+                iter = _mm512_mask_add_ps(iter, active, iter, one);
+            }
+            iter = _mm512_min_ps(iter, limit);
+            active &= _mm512_cmp_ps_mask(iter, limit, _CMP_LT_OQ);
+            
+            __mmask16 cycled = active &
+                _mm512_cmp_ps_mask(_mm512_abs_ps(_mm512_sub_ps(zr, saved_r)), epsilon, _CMP_LT_OQ) &
+                _mm512_cmp_ps_mask(_mm512_abs_ps(_mm512_sub_ps(zi, saved_i)), epsilon, _CMP_LT_OQ);
+            iter = _mm512_mask_mov_ps(iter, cycled, limit);
+            
+            __mmask16 save = active & _mm512_cmp_ps_mask(iter, next_save, _CMP_EQ_OQ);
+            saved_r = _mm512_mask_mov_ps(saved_r, save, zr);
+            saved_i = _mm512_mask_mov_ps(saved_i, save, zi);
+            next_save = _mm512_mask_add_ps(next_save, save, next_save, next_save);
+            
+            done = cycled | (__mmask16)~active;
+        } while (!done);
+        
+        _mm512_storeu_ps(lanes.zr, zr);
+        _mm512_storeu_ps(lanes.zi, zi);
+        _mm512_storeu_ps(lanes.block_zr, block_zr);
+        _mm512_storeu_ps(lanes.block_zi, block_zi);
+        _mm512_storeu_ps(lanes.iter, iter);
+        _mm512_storeu_ps(lanes.saved_r, saved_r);
+        _mm512_storeu_ps(lanes.saved_i, saved_i);
+        _mm512_storeu_ps(lanes.next_save, next_save);
+        retire_float_lanes(&lanes, AVX512_FLOAT_LANES, done);
+    }
+    return lanes.skipped;
+}
+
+// Coloring, see lookup_color(): the phase and then the color of every value
+// are gathered from the tables. The last few values of a span go through
+// masked loads and stores instead of a scalar tail.
+__attribute__((target("avx2")))
+void color_span_avx2(const int* values, Uint32* pixels, int count, float scale, const ColorTable* table) {
+    const __m256 scale_factor = _mm256_set1_ps(scale);
+    const __m256 bias = _mm256_set1_ps(COLOR_T_BIAS);
+    const __m256i base = _mm256_set1_epi32(PHASE_TABLE_BASE);
+    const __m256i last = _mm256_set1_epi32(PHASE_TABLE_SIZE - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i offset = _mm256_set1_epi32(table->offset);
+    const __m256i wrap = _mm256_set1_epi32(COLOR_TABLE_SIZE - 1);
+    const __m256i interior = _mm256_set1_epi32(ESCAPE_INTERIOR);
+    const __m256i black = _mm256_set1_epi32(pack_argb(0, 0, 0));
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    
+    for (int i = 0; i < count; i += 8) {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), lane);
+        __m256i value = _mm256_maskload_epi32(values + i, mask);
+        
+        __m256 t = _mm256_cvtepi32_ps(_mm256_srai_epi32(value, ESCAPE_FLAG_BITS));
+        t = _mm256_add_ps(_mm256_mul_ps(t, scale_factor), bias);
+        __m256i index = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(t), 23 - PHASE_MANTISSA_BITS), base);
+        index = _mm256_min_epi32(_mm256_max_epi32(index, zero), last);
+        __m256i phase = _mm256_i32gather_epi32((const int*)table->phases, index, 4);
+        phase = _mm256_and_si256(_mm256_add_epi32(phase, offset), wrap);
+        __m256i color = _mm256_i32gather_epi32((const int*)table->colors, phase, 4);
+        
+        // glitched and interior pixels are black
+        __m256i hidden = _mm256_or_si256(_mm256_cmpgt_epi32(zero, value),
+                                         _mm256_cmpeq_epi32(_mm256_and_si256(value, interior), interior));
+        color = _mm256_blendv_epi8(color, black, hidden);
+        _mm256_maskstore_epi32((int*)(pixels + i), mask, color);
+    }
+}
+
+__attribute__((target("avx512f")))
+void color_span_avx512(const int* values, Uint32* pixels, int count, float scale, const ColorTable* table) {
+    const __m512 scale_factor = _mm512_set1_ps(scale);
+    const __m512 bias = _mm512_set1_ps(COLOR_T_BIAS);
+    const __m512i base = _mm512_set1_epi32(PHASE_TABLE_BASE);
+    const __m512i last = _mm512_set1_epi32(PHASE_TABLE_SIZE - 1);
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i offset = _mm512_set1_epi32(table->offset);
+    const __m512i wrap = _mm512_set1_epi32(COLOR_TABLE_SIZE - 1);
+    const __m512i interior = _mm512_set1_epi32(ESCAPE_INTERIOR);
+    const __m512i black = _mm512_set1_epi32(pack_argb(0, 0, 0));
+    
+    for (int i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? 0xFFFF : (__mmask16)((1u << (count - i)) - 1);
+        __m512i value = _mm512_maskz_loadu_epi32(mask, values + i);
+        
+        __m512 t = _mm512_cvtepi32_ps(_mm512_srai_epi32(value, ESCAPE_FLAG_BITS));
+        t = _mm512_add_ps(_mm512_mul_ps(t, scale_factor), bias);
+        __m512i index = _mm512_sub_epi32(_mm512_srli_epi32(_mm512_castps_si512(t), 23 - PHASE_MANTISSA_BITS), base);
+        index = _mm512_min_epi32(_mm512_max_epi32(index, zero), last);
+        __m512i phase = _mm512_i32gather_epi32(index, table->phases, 4);
+        phase = _mm512_and_si512(_mm512_add_epi32(phase, offset), wrap);
+        __m512i color = _mm512_i32gather_epi32(phase, table->colors, 4);
+        
+        __mmask16 hidden = _mm512_cmplt_epi32_mask(value, zero) | _mm512_test_epi32_mask(value, interior);
+        color = _mm512_mask_mov_epi32(color, hidden, black);
+        _mm512_mask_storeu_epi32(pixels + i, mask, color);
+    }
+}
+
+#endif
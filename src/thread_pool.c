@@ -0,0 +1,232 @@
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Each worker owns a deque of task indices. The owner pops from the tail,
+// idle workers steal from the head of someone else's deque, so expensive
+// regions of a frame get spread over every core instead of a fixed stripe.
+typedef struct {
+    int* tasks;
+    int capacity;
+    int head;
+    int tail;
+    SDL_SpinLock lock;
+} TaskDeque;
+
+typedef struct {
+    ThreadPool* pool;
+    int index;
+    SDL_Thread* thread;
+} Worker;
+
+struct ThreadPool {
+    Worker* workers;
+    TaskDeque* deques;
+    int worker_count;
+
+    SDL_mutex* mutex;
+    SDL_cond* work_ready;
+    SDL_cond* work_done;
+    int generation;
+    int busy_workers;
+    int quit;
+
+    TaskFunc func;
+    void* context;
+};
+
+static int pop_task(TaskDeque* deque, int* task) {
+    int found = 0;
+    SDL_AtomicLock(&deque->lock);
+    if (deque->tail > deque->head) {
+        *task = deque->tasks[--deque->tail];
+        found = 1;
+    }
+    SDL_AtomicUnlock(&deque->lock);
+    return found;
+}
+
+static int steal_task(TaskDeque* deque, int* task) {
+    int found = 0;
+    SDL_AtomicLock(&deque->lock);
+    if (deque->tail > deque->head) {
+        *task = deque->tasks[deque->head++];
+        found = 1;
+    }
+    SDL_AtomicUnlock(&deque->lock);
+    return found;
+}
+
+// Tasks are only added before a batch starts, so once every deque has been
+// seen empty there is nothing left for this worker to do.
+static void work_until_empty(ThreadPool* pool, int index) {
+    int task;
+    for (;;) {
+        if (pop_task(&pool->deques[index], &task)) {
+            pool->func(pool->context, task);
+            continue;
+        }
+        
+        int stolen = 0;
+        for (int i = 1; i < pool->worker_count && !stolen; i++) {
+            int victim = (index + i) % pool->worker_count;
+            stolen = steal_task(&pool->deques[victim], &task);
+        }
+        if (!stolen) {
+            return;
+        }
+        pool->func(pool->context, task);
+    }
+}
+
+static int worker_main(void* data) {
+    Worker* worker = data;
+    ThreadPool* pool = worker->pool;
+    int seen_generation = 0;
+    
+    for (;;) {
+        SDL_LockMutex(pool->mutex);
+        while (!pool->quit && pool->generation == seen_generation) {
+            SDL_CondWait(pool->work_ready, pool->mutex);
+        }
+        if (pool->quit) {
+            SDL_UnlockMutex(pool->mutex);
+            return 0;
+        }
+        seen_generation = pool->generation;
+        SDL_UnlockMutex(pool->mutex);
+        
+        work_until_empty(pool, worker->index);
+        
+        SDL_LockMutex(pool->mutex);
+        if (--pool->busy_workers == 0) {
+            SDL_CondSignal(pool->work_done);
+        }
+        SDL_UnlockMutex(pool->mutex);
+    }
+}
+
+ThreadPool* create_thread_pool(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = SDL_GetCPUCount();
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->worker_count = thread_count;
+    pool->workers = calloc(thread_count, sizeof(Worker));
+    pool->deques = calloc(thread_count, sizeof(TaskDeque));
+    pool->mutex = SDL_CreateMutex();
+    pool->work_ready = SDL_CreateCond();
+    pool->work_done = SDL_CreateCond();
+    if (!pool->workers || !pool->deques || !pool->mutex || !pool->work_ready || !pool->work_done) {
+        destroy_thread_pool(pool);
+        return NULL;
+    }
+    
+    // worker 0 is whoever calls run_thread_pool(), it gets no thread of its own
+    for (int i = 0; i < thread_count; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+    }
+    for (int i = 1; i < thread_count; i++) {
+        pool->workers[i].thread = SDL_CreateThread(worker_main, "render worker", &pool->workers[i]);
+        if (!pool->workers[i].thread) {
+            printf("Worker thread could not be created: %s\n", SDL_GetError());
+            pool->worker_count = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+void run_thread_pool(ThreadPool* pool, TaskFunc func, void* context, int task_count) {
+    if (task_count <= 0) {
+        return;
+    }
+    
+    pool->func = func;
+    pool->context = context;
+    
+    int per_worker = (task_count + pool->worker_count - 1) / pool->worker_count;
+    for (int i = 0; i < pool->worker_count; i++) {
+        TaskDeque* deque = &pool->deques[i];
+        if (deque->capacity < per_worker) {
+            int* tasks = realloc(deque->tasks, sizeof(int) * per_worker);
+            if (!tasks) {
+                // fall back to running the whole batch on the calling thread
+                for (int task = 0; task < task_count; task++) {
+                    func(context, task);
+                }
+                return;
+            }
+            deque->tasks = tasks;
+            deque->capacity = per_worker;
+        }
+        deque->head = 0;
+        deque->tail = 0;
+    }
+    
+    // deal tasks round-robin so neighbouring tiles, which tend to cost the
+    // same, start out on different workers; pushed in reverse so each owner
+    // pops its tasks in ascending order
+    for (int task = task_count - 1; task >= 0; task--) {
+        TaskDeque* deque = &pool->deques[task % pool->worker_count];
+        deque->tasks[deque->tail++] = task;
+    }
+    
+    SDL_LockMutex(pool->mutex);
+    pool->busy_workers = pool->worker_count - 1;
+    pool->generation++;
+    SDL_CondBroadcast(pool->work_ready);
+    SDL_UnlockMutex(pool->mutex);
+    
+    work_until_empty(pool, 0);
+    
+    SDL_LockMutex(pool->mutex);
+    while (pool->busy_workers > 0) {
+        SDL_CondWait(pool->work_done, pool->mutex);
+    }
+    SDL_UnlockMutex(pool->mutex);
+}
+
+int get_thread_pool_size(ThreadPool* pool) {
+    return pool->worker_count;
+}
+
+void destroy_thread_pool(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+    
+    if (pool->mutex) {
+        SDL_LockMutex(pool->mutex);
+        pool->quit = 1;
+        if (pool->work_ready) {
+            SDL_CondBroadcast(pool->work_ready);
+        }
+        SDL_UnlockMutex(pool->mutex);
+    }
+    if (pool->workers) {
+        for (int i = 1; i < pool->worker_count; i++) {
+            SDL_WaitThread(pool->workers[i].thread, NULL);
+        }
+    }
+    if (pool->deques) {
+        for (int i = 0; i < pool->worker_count; i++) {
+            free(pool->deques[i].tasks);
+        }
+    }
+    
+    SDL_DestroyCond(pool->work_done);
+    SDL_DestroyCond(pool->work_ready);
+    SDL_DestroyMutex(pool->mutex);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
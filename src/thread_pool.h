@@ -0,0 +1,18 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <SDL.h>
+
+// Called once for every task index in [0, task_count) of a batch.
+typedef void (*TaskFunc)(void* context, int task);
+
+typedef struct ThreadPool ThreadPool;
+
+// thread_count <= 0 sizes the pool to the number of logical cores.
+// The thread calling run_thread_pool() counts as one of the workers.
+ThreadPool* create_thread_pool(int thread_count);
+void run_thread_pool(ThreadPool* pool, TaskFunc func, void* context, int task_count);
+int get_thread_pool_size(ThreadPool* pool);
+void destroy_thread_pool(ThreadPool* pool);
+
+#endif
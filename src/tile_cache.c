@@ -0,0 +1,434 @@
+#include "tile_cache.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coloring.h"
+#include "perturbation.h"
+#include "tile_store.h"
+
+// lattice indices stay well below 2^53 so every lattice point is an exact double
+#define MAX_LATTICE_BITS 50
+
+struct TileEntry {
+    TileKey key;
+    TileEntry* hash_next;
+    TileEntry* newer;       // neighbours in the LRU list
+    TileEntry* older;
+    int pinned;             // part of the frame being looked up, not evicted
+    int unknown;            // points still GLITCHED in iterations
+    int iterations[TILE_SIZE * TILE_SIZE];
+};
+
+struct TileCache {
+    TileEntry** buckets;
+    Uint64 bucket_mask;
+    TileEntry* newest;
+    TileEntry* oldest;
+    int max_tiles;
+    TileStore* store;
+    TileCacheStats stats;
+};
+
+static Uint64 mix(Uint64 hash, Uint64 value) {
+    return hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+}
+
+static Uint64 double_bits(double value) {
+    Uint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+Uint64 hash_tile_key(const TileKey* key) {
+    Uint64 hash = mix(0, (Uint64)key->tx);
+    hash = mix(hash, (Uint64)key->ty);
+    hash = mix(hash, (Uint64)key->level);
+    hash = mix(hash, ((Uint64)key->max_iterations << 8) | ((Uint64)key->strategy << 4) |
+                       ((Uint64)key->precision << 1) | (Uint64)key->is_julia);
+    hash = mix(hash, double_bits(key->julia_c.real));
+    hash = mix(hash, double_bits(key->julia_c.imag));
+    // fold the high bits into the low ones the masks keep
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static TileEntry** find_bucket(const TileCache* cache, const TileKey* key) {
+    return &cache->buckets[hash_tile_key(key) & cache->bucket_mask];
+}
+
+static int keys_equal(const TileKey* a, const TileKey* b) {
+    return a->tx == b->tx && a->ty == b->ty && a->level == b->level && a->is_julia == b->is_julia &&
+           a->julia_c.real == b->julia_c.real && a->julia_c.imag == b->julia_c.imag &&
+           a->precision == b->precision && a->max_iterations == b->max_iterations && a->strategy == b->strategy;
+}
+
+static void unlink_lru(TileCache* cache, TileEntry* entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+static void push_newest(TileCache* cache, TileEntry* entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+static TileEntry* find_entry(TileCache* cache, const TileKey* key) {
+    for (TileEntry* entry = *find_bucket(cache, key); entry; entry = entry->hash_next) {
+        if (keys_equal(&entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Takes entry out of the cache without freeing it
+static void remove_entry(TileCache* cache, TileEntry* entry) {
+    TileEntry** link = find_bucket(cache, &entry->key);
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    unlink_lru(cache, entry);
+    cache->stats.tiles--;
+    cache->stats.bytes -= sizeof(TileEntry);
+}
+
+// Removes the least recently used tile that no frame is using, NULL if every tile is pinned
+static TileEntry* evict_entry(TileCache* cache) {
+    TileEntry* victim = cache->oldest;
+    while (victim && victim->pinned) {
+        victim = victim->newer;
+    }
+    if (victim) {
+        remove_entry(cache, victim);
+        cache->stats.evictions++;
+    }
+    return victim;
+}
+
+// A new entry for key with every point unknown. Least recently used tiles make room
+// once the cache is full, but pinned ones stay, so a frame needing more than
+// the limit still gets all of its tiles.
+static TileEntry* add_entry(TileCache* cache, const TileKey* key) {
+    TileEntry* entry = NULL;
+    if (cache->stats.tiles >= cache->max_tiles) {
+        entry = evict_entry(cache);
+    }
+    if (!entry) {
+        entry = malloc(sizeof(TileEntry));
+        if (!entry) {
+            return NULL;
+        }
+    }
+    
+    TileEntry** bucket = find_bucket(cache, key);
+    entry->key = *key;
+    entry->hash_next = *bucket;
+    entry->pinned = 0;
+    entry->unknown = TILE_SIZE * TILE_SIZE;
+    for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+        entry->iterations[i] = GLITCHED;
+    }
+    *bucket = entry;
+    push_newest(cache, entry);
+    cache->stats.tiles++;
+    cache->stats.bytes += sizeof(TileEntry);
+    return entry;
+}
+
+TileCache* create_tile_cache(size_t memory_limit) {
+    TileCache* cache = calloc(1, sizeof(TileCache));
+    if (!cache) {
+        return NULL;
+    }
+    
+    cache->max_tiles = (int)SDL_min(memory_limit / sizeof(TileEntry), INT_MAX / 2);
+    cache->max_tiles = SDL_max(cache->max_tiles, 1);
+    // about one tile per bucket when full
+    Uint64 bucket_count = 64;
+    while (bucket_count < (Uint64)cache->max_tiles) {
+        bucket_count *= 2;
+    }
+    cache->buckets = calloc(bucket_count, sizeof(TileEntry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+    cache->bucket_mask = bucket_count - 1;
+    cache->stats.memory_limit = memory_limit;
+    return cache;
+}
+
+void destroy_tile_cache(TileCache* cache) {
+    if (!cache) {
+        return;
+    }
+    TileEntry* entry = cache->newest;
+    while (entry) {
+        TileEntry* older = entry->older;
+        free(entry);
+        entry = older;
+    }
+    free(cache->buckets);
+    free(cache);
+}
+
+TileCacheStats get_tile_cache_stats(const TileCache* cache) {
+    return cache->stats;
+}
+
+void set_tile_cache_store(TileCache* cache, TileStore* store) {
+    cache->store = store;
+}
+
+static Sint64 floor_div(Sint64 a, Sint64 b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// The count of the lattice point nearest to pixel (x, y), GLITCHED if no frame has covered it yet
+static int lattice_value(const CachedRender* render, int x, int y) {
+    Sint64 tile_x = floor_div(render->lattice_x[x], TILE_SIZE);
+    Sint64 tile_y = floor_div(render->lattice_y[y], TILE_SIZE);
+    const TileEntry* entry = render->window[(tile_y - render->first_tile_y) * render->tiles_x +
+                                            tile_x - render->first_tile_x];
+    if (!entry) {
+        return GLITCHED;
+    }
+    int row = (int)(render->lattice_y[y] - tile_y * TILE_SIZE);
+    int column = (int)(render->lattice_x[x] - tile_x * TILE_SIZE);
+    return entry->iterations[row * TILE_SIZE + column];
+}
+
+int start_cached_render(CachedRender* render, TileCache* cache, const FrameBuffer* fb, const PixelGrid* grid,
+                        RenderStrategy strategy) {
+    memset(render, 0, sizeof(*render));
+    if (grid->precision > PRECISION_DOUBLE) {
+        return 0;
+    }
+    
+    // the finest level that is no denser than the pixels, so no more points
+    // are kept than a frame has pixels to fill them from
+    double pixel_spacing = fmax(grid->step_x, grid->step_y);
+    int level = (int)floor(-log2(pixel_spacing));
+    double spacing = ldexp(1.0, -level);
+    double extent = fmax(fabs(grid->origin.real) + fb->width * grid->step_x,
+                         fabs(grid->origin.imag) + fb->height * grid->step_y);
+    if (!(pixel_spacing > 0.0) || extent / spacing >= ldexp(1.0, MAX_LATTICE_BITS)) {
+        return 0;
+    }
+    
+    render->cache = cache;
+    render->grid = *grid;
+    render->level = level;
+    render->lattice_x = malloc(sizeof(Sint64) * fb->width);
+    render->lattice_y = malloc(sizeof(Sint64) * fb->height);
+    if (!render->lattice_x || !render->lattice_y) {
+        finish_cached_render(render);
+        return 0;
+    }
+    for (int x = 0; x < fb->width; x++) {
+        render->lattice_x[x] = (Sint64)floor((grid->origin.real + x * grid->step_x) / spacing + 0.5);
+    }
+    for (int y = 0; y < fb->height; y++) {
+        render->lattice_y[y] = (Sint64)floor((grid->origin.imag + y * grid->step_y) / spacing + 0.5);
+    }
+    
+    // pixels and lattice both grow to the right and down, the corners bound
+    // the frame, and with the lattice no denser than the pixels every point
+    // in between is the nearest one to some pixel
+    render->first_tile_x = floor_div(render->lattice_x[0], TILE_SIZE);
+    render->first_tile_y = floor_div(render->lattice_y[0], TILE_SIZE);
+    render->tiles_x = (int)(floor_div(render->lattice_x[fb->width - 1], TILE_SIZE) - render->first_tile_x + 1);
+    render->tiles_y = (int)(floor_div(render->lattice_y[fb->height - 1], TILE_SIZE) - render->first_tile_y + 1);
+    int tile_count = render->tiles_x * render->tiles_y;
+    render->window = calloc(tile_count, sizeof(TileEntry*));
+    if (!render->window) {
+        finish_cached_render(render);
+        return 0;
+    }
+    
+    render->key = (TileKey){
+        .level = level,
+        .is_julia = grid->is_julia,
+        .julia_c = grid->is_julia ? grid->julia_c : (Complex){0.0, 0.0},
+        .precision = grid->precision,
+        .max_iterations = grid->max_iterations,
+        .strategy = strategy
+    };
+    render->complete = 1;
+    for (int i = 0; i < tile_count; i++) {
+        TileKey key = render->key;
+        key.tx = render->first_tile_x + i % render->tiles_x;
+        key.ty = render->first_tile_y + i / render->tiles_x;
+        TileEntry* entry = find_entry(cache, &key);
+        if (entry) {
+            unlink_lru(cache, entry);
+            push_newest(cache, entry);
+            cache->stats.hits++;
+        } else {
+            cache->stats.misses++;
+            int counts[TILE_SIZE * TILE_SIZE];
+            if (cache->store && load_stored_tile(cache->store, &key, counts) && (entry = add_entry(cache, &key))) {
+                memcpy(entry->iterations, counts, sizeof(counts));
+                entry->unknown = 0;
+                for (int j = 0; j < TILE_SIZE * TILE_SIZE; j++) {
+                    entry->unknown += counts[j] == GLITCHED;
+                }
+            }
+        }
+        if (entry) {
+            entry->pinned = 1;
+        }
+        render->window[i] = entry;
+        render->complete = render->complete && entry && entry->unknown == 0;
+    }
+    
+    // a tile partly covered before may still have every point this frame needs
+    if (!render->complete) {
+        render->complete = 1;
+        for (int y = 0; y < fb->height && render->complete; y++) {
+            for (int x = 0; x < fb->width; x++) {
+                if (lattice_value(render, x, y) == GLITCHED) {
+                    render->complete = 0;
+                    break;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+typedef struct {
+    const CachedRender* render;
+    FrameBuffer* fb;
+} ComposeJob;
+
+// Copies and colors the pixels of row y whose lattice points are known
+static void compose_row(void* context, int y) {
+    ComposeJob* job = context;
+    const CachedRender* render = job->render;
+    FrameBuffer* fb = job->fb;
+    
+    for (int x = 0; x < fb->width; x++) {
+        int iterations = lattice_value(render, x, y);
+        if (iterations == GLITCHED)
+            continue;
+        fb->iterations[y * fb->width + x] = iterations;
+        fb->pixels[y * fb->width + x] = color_escape_value(iterations, render->grid.max_iterations);
+    }
+}
+
+void compose_cached_render(const CachedRender* render, ThreadPool* pool, FrameBuffer* fb) {
+    ComposeJob job = {render, fb};
+    run_thread_pool(pool, compose_row, &job, fb->height);
+    upload_frame_buffer(fb);
+}
+
+void save_cached_tiles(TileCache* cache, const FrameBuffer* fb, const PixelGrid* grid, RenderStrategy strategy) {
+    CachedRender render;
+    if (!start_cached_render(&render, cache, fb, grid, strategy)) {
+        return;
+    }
+    if (render.complete) {
+        finish_cached_render(&render);
+        return;
+    }
+    
+    // the pixel nearest to every lattice point the frame covers
+    double spacing = ldexp(1.0, -render.level);
+    Sint64 first_x = render.lattice_x[0];
+    Sint64 first_y = render.lattice_y[0];
+    int columns = (int)(render.lattice_x[fb->width - 1] - first_x + 1);
+    int rows = (int)(render.lattice_y[fb->height - 1] - first_y + 1);
+    int* pixel_x = malloc(sizeof(int) * columns);
+    int* pixel_y = malloc(sizeof(int) * rows);
+    if (!pixel_x || !pixel_y) {
+        free(pixel_x);
+        free(pixel_y);
+        finish_cached_render(&render);
+        return;
+    }
+    for (int i = 0; i < columns; i++) {
+        double position = ((first_x + i) * spacing - grid->origin.real) / grid->step_x;
+        pixel_x[i] = SDL_clamp((int)floor(position + 0.5), 0, fb->width - 1);
+    }
+    for (int i = 0; i < rows; i++) {
+        double position = ((first_y + i) * spacing - grid->origin.imag) / grid->step_y;
+        pixel_y[i] = SDL_clamp((int)floor(position + 0.5), 0, fb->height - 1);
+    }
+    
+    for (int i = 0; i < render.tiles_x * render.tiles_y; i++) {
+        TileEntry* entry = render.window[i];
+        if (entry && entry->unknown == 0)
+            continue;
+        
+        TileKey key = render.key;
+        key.tx = render.first_tile_x + i % render.tiles_x;
+        key.ty = render.first_tile_y + i / render.tiles_x;
+        if (!entry && !(entry = add_entry(cache, &key))) {
+            break;
+        }
+        entry->pinned = 1;
+        render.window[i] = entry;
+        
+        int filled = 0;
+        for (int j = 0; j < TILE_SIZE; j++) {
+            Sint64 row = key.ty * TILE_SIZE + j - first_y;
+            if (row < 0 || row >= rows)
+                continue;
+            const int* source = fb->iterations + pixel_y[row] * fb->width;
+            for (int k = 0; k < TILE_SIZE; k++) {
+                Sint64 column = key.tx * TILE_SIZE + k - first_x;
+                if (column < 0 || column >= columns || entry->iterations[j * TILE_SIZE + k] != GLITCHED)
+                    continue;
+                entry->iterations[j * TILE_SIZE + k] = source[pixel_x[column]];
+                filled++;
+            }
+        }
+        entry->unknown -= filled;
+        if (filled && cache->store) {
+            save_stored_tile(cache->store, &key, entry->iterations);
+        }
+    }
+    free(pixel_x);
+    free(pixel_y);
+    finish_cached_render(&render);
+}
+
+void finish_cached_render(CachedRender* render) {
+    if (render->cache && render->window) {
+        for (int i = 0; i < render->tiles_x * render->tiles_y; i++) {
+            if (render->window[i]) {
+                render->window[i]->pinned = 0;
+            }
+        }
+        // a frame bigger than the limit leaves the cache over it until now
+        TileEntry* evicted = NULL;
+        while (render->cache->stats.tiles > render->cache->max_tiles && (evicted = evict_entry(render->cache))) {
+            free(evicted);
+        }
+    }
+    free(render->window);
+    free(render->lattice_x);
+    free(render->lattice_y);
+    memset(render, 0, sizeof(*render));
+}
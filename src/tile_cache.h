@@ -0,0 +1,82 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "mandelbrot.h"
+
+// Escape counts on a power-of-two lattice of the plane. At level L the
+// lattice spacing is 2^-L and tile (tx, ty) holds the TILE_SIZE x TILE_SIZE
+// points (tx * TILE_SIZE + i, ty * TILE_SIZE + j) * 2^-L. A frame uses the
+// finest level that is no denser than its pixels. Nothing is iterated for the
+// lattice: a finished frame gives every lattice point it covers the count of
+// the pixel nearest to it, and a frame whose pixels all find a known point
+// nearest to them is composed without iterating. Points no frame has covered
+// yet hold GLITCHED. Tiles are keyed by (level, tx, ty, fractal, Julia c,
+// precision, iteration limit) and the least recently used ones are dropped
+// to stay within the memory limit.
+typedef struct TileCache TileCache;
+typedef struct TileEntry TileEntry;
+typedef struct TileStore TileStore;
+
+#define DEFAULT_TILE_CACHE_MB 64
+
+typedef struct {
+    Sint64 tx;
+    Sint64 ty;
+    int level;
+    int is_julia;
+    Complex julia_c;            // 0 for the Mandelbrot set
+    Precision precision;
+    int max_iterations;
+    RenderStrategy strategy;    // Mariani-Silver tiles may differ from exact ones
+} TileKey;
+
+typedef struct {
+    Uint64 hits;            // tiles a frame found in the cache
+    Uint64 misses;          // tiles a frame had to load from the store or compute
+    Uint64 evictions;
+    int tiles;
+    size_t bytes;
+    size_t memory_limit;
+} TileCacheStats;
+
+// The lattice tiles covering a frame
+typedef struct {
+    TileCache* cache;       // NULL once the frame is finished
+    PixelGrid grid;
+    TileKey key;            // of the frame's tiles, tx and ty aside
+    int level;
+    int complete;           // every pixel has a known lattice point
+    Sint64 first_tile_x;
+    Sint64 first_tile_y;
+    int tiles_x;
+    int tiles_y;
+    TileEntry** window;     // tiles_x * tiles_y tiles covering the frame row by row, NULL where missing
+    Sint64* lattice_x;      // nearest lattice column of every pixel column
+    Sint64* lattice_y;
+} CachedRender;
+
+TileCache* create_tile_cache(size_t memory_limit);
+void destroy_tile_cache(TileCache* cache);
+TileCacheStats get_tile_cache_stats(const TileCache* cache);
+// Tiles the cache misses are looked up in store before they are computed,
+// and computed ones are saved to it. NULL detaches the store.
+void set_tile_cache_store(TileCache* cache, TileStore* store);
+// Mixes every field of key, the same in every process
+Uint64 hash_tile_key(const TileKey* key);
+
+// Looks up the tiles of the frame in the cache, then in the store. Returns 0
+// if grid cannot be composed from the lattice (past double precision) or
+// memory runs out. Writes no pixels.
+int start_cached_render(CachedRender* render, TileCache* cache, const FrameBuffer* fb, const PixelGrid* grid,
+                        RenderStrategy strategy);
+// Copies and colors every pixel whose lattice point is known and uploads the
+// frame. Leaves the rest of the frame alone, a frame that is not complete
+// only gets a better stand-in.
+void compose_cached_render(const CachedRender* render, ThreadPool* pool, FrameBuffer* fb);
+// Lets go of the frame's tiles. Does nothing for a frame that is already finished.
+void finish_cached_render(CachedRender* render);
+// Fills the lattice points fb covers that are not known yet from the pixels
+// of fb, computed for grid, and saves the tiles that changed to the store
+void save_cached_tiles(TileCache* cache, const FrameBuffer* fb, const PixelGrid* grid, RenderStrategy strategy);
+
+#endif
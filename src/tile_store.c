@@ -0,0 +1,409 @@
+#include "tile_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define STORE_MAGIC "MBTILES"
+#define STORE_VERSION 2         // 2: tiles hold packed escape values, not plain counts
+// slots a key may land in, the least used one is replaced when all are taken
+#define BUCKET_WAYS 16
+#define STORE_PAGE 4096
+#define TILE_COUNTS (TILE_SIZE * TILE_SIZE)
+
+typedef struct {
+    char magic[8];
+    Uint32 version;
+    Uint32 tile_size;
+    Uint32 entry_size;
+    Uint32 slot_count;
+    Uint64 index_offset;
+    Uint64 slots_offset;
+    Uint64 file_size;
+} StoreHeader;
+
+// Fixed-width copy of a TileKey, followed by how often the tile was loaded
+typedef struct {
+    Sint64 tx;
+    Sint64 ty;
+    double julia_real;
+    double julia_imag;
+    Sint32 level;
+    Sint32 is_julia;
+    Sint32 precision;
+    Sint32 max_iterations;
+    Sint32 strategy;
+    Uint32 uses;
+    Uint64 checksum;        // 0 while the slot is empty or being written
+} StoredEntry;
+
+struct TileStore {
+    Uint8* map;
+    size_t map_size;
+    StoreHeader* header;
+    StoredEntry* index;
+    Sint32* slots;
+    Uint64 bucket_mask;
+    TileStoreStats stats;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+// Platform layer: an exclusively locked read-write file, or a shared
+// read-only one when another process holds the lock.
+
+#ifdef _WIN32
+
+static int open_file(TileStore* store, const char* path) {
+    store->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (store->file != INVALID_HANDLE_VALUE) {
+        // a byte far past the end stands for the whole file, locking the
+        // tiles themselves would stop other processes from reading them
+        OVERLAPPED overlapped = {0};
+        overlapped.OffsetHigh = 0x7FFFFFFF;
+        if (LockFileEx(store->file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped)) {
+            return 1;
+        }
+        CloseHandle(store->file);
+    }
+    store->stats.read_only = 1;
+    store->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    return store->file != INVALID_HANDLE_VALUE;
+}
+
+static int get_file_size(TileStore* store, Uint64* size) {
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(store->file, &file_size)) {
+        return 0;
+    }
+    *size = (Uint64)file_size.QuadPart;
+    return 1;
+}
+
+// Truncates the file to nothing and then grows it to size, so it reads as zeros
+static int reset_file(TileStore* store, Uint64 size) {
+    LARGE_INTEGER position = {0};
+    if (!SetFilePointerEx(store->file, position, NULL, FILE_BEGIN) || !SetEndOfFile(store->file)) {
+        return 0;
+    }
+    position.QuadPart = (LONGLONG)size;
+    return SetFilePointerEx(store->file, position, NULL, FILE_BEGIN) && SetEndOfFile(store->file);
+}
+
+static int map_file(TileStore* store, Uint64 size) {
+    store->mapping = CreateFileMappingA(store->file, NULL, store->stats.read_only ? PAGE_READONLY : PAGE_READWRITE,
+                                        0, 0, NULL);
+    if (!store->mapping) {
+        return 0;
+    }
+    store->map = MapViewOfFile(store->mapping, store->stats.read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, 0);
+    store->map_size = (size_t)size;
+    return store->map != NULL;
+}
+
+static void unmap_file(TileStore* store) {
+    if (store->map) {
+        if (!store->stats.read_only) {
+            FlushViewOfFile(store->map, 0);
+        }
+        UnmapViewOfFile(store->map);
+        store->map = NULL;
+    }
+    if (store->mapping) {
+        CloseHandle(store->mapping);
+        store->mapping = NULL;
+    }
+}
+
+static void close_file(TileStore* store) {
+    unmap_file(store);
+    if (store->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(store->file);
+    }
+}
+
+#else
+
+static int open_file(TileStore* store, const char* path) {
+    store->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (store->fd >= 0) {
+        if (flock(store->fd, LOCK_EX | LOCK_NB) == 0) {
+            return 1;
+        }
+        close(store->fd);
+    }
+    store->stats.read_only = 1;
+    store->fd = open(path, O_RDONLY);
+    return store->fd >= 0;
+}
+
+static int get_file_size(TileStore* store, Uint64* size) {
+    struct stat info;
+    if (fstat(store->fd, &info) != 0) {
+        return 0;
+    }
+    *size = (Uint64)info.st_size;
+    return 1;
+}
+
+// Truncates the file to nothing and then grows it to size, so it reads as zeros
+static int reset_file(TileStore* store, Uint64 size) {
+    return ftruncate(store->fd, 0) == 0 && ftruncate(store->fd, (off_t)size) == 0;
+}
+
+static int map_file(TileStore* store, Uint64 size) {
+    int protection = store->stats.read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* map = mmap(NULL, (size_t)size, protection, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    store->map = map;
+    store->map_size = (size_t)size;
+    return 1;
+}
+
+static void unmap_file(TileStore* store) {
+    if (store->map) {
+        if (!store->stats.read_only) {
+            msync(store->map, store->map_size, MS_ASYNC);
+        }
+        munmap(store->map, store->map_size);
+        store->map = NULL;
+    }
+}
+
+static void close_file(TileStore* store) {
+    unmap_file(store);
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+}
+
+#endif
+
+static Uint64 align_page(Uint64 offset) {
+    return (offset + STORE_PAGE - 1) / STORE_PAGE * STORE_PAGE;
+}
+
+// The layout of a new store of about size_mb megabytes
+static StoreHeader plan_store(size_t size_mb) {
+    Uint64 slot_bytes = sizeof(StoredEntry) + sizeof(Sint32) * TILE_COUNTS;
+    Uint64 buckets = 1;
+    while (buckets * 2 * BUCKET_WAYS * slot_bytes <= (Uint64)size_mb * 1024 * 1024) {
+        buckets *= 2;
+    }
+    
+    StoreHeader header = {
+        .magic = STORE_MAGIC,
+        .version = STORE_VERSION,
+        .tile_size = TILE_SIZE,
+        .entry_size = sizeof(StoredEntry),
+        .slot_count = (Uint32)(buckets * BUCKET_WAYS)
+    };
+    header.index_offset = STORE_PAGE;
+    header.slots_offset = align_page(header.index_offset + header.slot_count * sizeof(StoredEntry));
+    header.file_size = header.slots_offset + header.slot_count * sizeof(Sint32) * TILE_COUNTS;
+    return header;
+}
+
+static int header_valid(const StoreHeader* header, Uint64 file_size) {
+    Uint32 buckets = header->slot_count / BUCKET_WAYS;
+    return memcmp(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0 &&
+           header->version == STORE_VERSION && header->tile_size == TILE_SIZE &&
+           header->entry_size == sizeof(StoredEntry) &&
+           buckets > 0 && (buckets & (buckets - 1)) == 0 && header->slot_count % BUCKET_WAYS == 0 &&
+           header->index_offset == STORE_PAGE &&
+           header->slots_offset == align_page(header->index_offset + header->slot_count * sizeof(StoredEntry)) &&
+           header->file_size == header->slots_offset + header->slot_count * sizeof(Sint32) * TILE_COUNTS &&
+           header->file_size == file_size;
+}
+
+TileStore* open_tile_store(const char* path, size_t size_mb) {
+    TileStore* store = calloc(1, sizeof(TileStore));
+    if (!store) {
+        return NULL;
+    }
+#ifdef _WIN32
+    store->file = INVALID_HANDLE_VALUE;
+#else
+    store->fd = -1;
+#endif
+    if (!open_file(store, path)) {
+        printf("Tile store '%s' could not be opened\n", path);
+        free(store);
+        return NULL;
+    }
+    
+    // only a file that was read and is not a store gets rebuilt; one that
+    // cannot be read right now may be a good store another process is using
+    StoreHeader existing = {0};
+    Uint64 size = 0;
+    if (!get_file_size(store, &size) || (size > 0 && !map_file(store, size))) {
+        printf("Tile store '%s' could not be read, running without it\n", path);
+        close_tile_store(store);
+        return NULL;
+    }
+    if (size >= sizeof(existing)) {
+        existing = *(const StoreHeader*)store->map;
+    }
+    if (!header_valid(&existing, size)) {
+        if (store->stats.read_only) {
+            printf("Tile store '%s' is not a tile store for this version\n", path);
+            close_tile_store(store);
+            return NULL;
+        }
+        unmap_file(store);
+        
+        // all slots start empty, the magic goes in last so a store cut
+        // short by a crash is rebuilt on the next start
+        StoreHeader header = plan_store(size_mb);
+        if (!reset_file(store, header.file_size) || !map_file(store, header.file_size)) {
+            printf("Tile store '%s' could not be created\n", path);
+            close_tile_store(store);
+            return NULL;
+        }
+        StoreHeader* mapped = (StoreHeader*)store->map;
+        *mapped = header;
+        memset(mapped->magic, 0, sizeof(mapped->magic));
+        SDL_MemoryBarrierRelease();
+        memcpy(mapped->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    }
+    
+    store->header = (StoreHeader*)store->map;
+    store->index = (StoredEntry*)(store->map + store->header->index_offset);
+    store->slots = (Sint32*)(store->map + store->header->slots_offset);
+    store->bucket_mask = store->header->slot_count / BUCKET_WAYS - 1;
+    store->stats.slots = (int)store->header->slot_count;
+    for (int i = 0; i < store->stats.slots; i++) {
+        if (store->index[i].checksum != 0) {
+            store->stats.used_slots++;
+        }
+    }
+    return store;
+}
+
+void close_tile_store(TileStore* store) {
+    if (!store) {
+        return;
+    }
+    close_file(store);
+    free(store);
+}
+
+TileStoreStats get_tile_store_stats(const TileStore* store) {
+    return store->stats;
+}
+
+static int entry_matches(const StoredEntry* entry, const TileKey* key) {
+    return entry->tx == key->tx && entry->ty == key->ty && entry->level == key->level &&
+           entry->is_julia == key->is_julia && entry->julia_real == key->julia_c.real &&
+           entry->julia_imag == key->julia_c.imag && entry->precision == (Sint32)key->precision &&
+           entry->max_iterations == key->max_iterations && entry->strategy == (Sint32)key->strategy;
+}
+
+// FNV-1a over the key and the counts a word at a time, never 0
+static Uint64 checksum_tile(const TileKey* key, const Sint32* counts) {
+    Uint64 hash = 0xCBF29CE484222325ull ^ hash_tile_key(key);
+    for (int i = 0; i < TILE_COUNTS; i++) {
+        hash = (hash ^ (Uint32)counts[i]) * 0x100000001B3ull;
+    }
+    return hash | 1;
+}
+
+static StoredEntry* find_store_bucket(TileStore* store, const TileKey* key) {
+    return store->index + (hash_tile_key(key) & store->bucket_mask) * BUCKET_WAYS;
+}
+
+int load_stored_tile(TileStore* store, const TileKey* key, int* iterations) {
+    StoredEntry* bucket = find_store_bucket(store, key);
+    for (int way = 0; way < BUCKET_WAYS; way++) {
+        volatile StoredEntry* entry = &bucket[way];
+        Uint64 checksum = entry->checksum;
+        SDL_MemoryBarrierAcquire();
+        if (checksum == 0 || !entry_matches((const StoredEntry*)entry, key)) {
+            continue;
+        }
+        
+        // a writer may be replacing the slot while it is copied, then the
+        // checksum no longer fits and the tile is computed instead
+        size_t slot = (size_t)(entry - store->index);
+        memcpy(iterations, store->slots + slot * TILE_COUNTS, sizeof(Sint32) * TILE_COUNTS);
+        SDL_MemoryBarrierAcquire();
+        if (entry->checksum != checksum || checksum_tile(key, iterations) != checksum) {
+            break;
+        }
+        if (!store->stats.read_only && entry->uses < 0xFFFFFFFFu) {
+            entry->uses++;
+        }
+        store->stats.loads++;
+        return 1;
+    }
+    store->stats.misses++;
+    return 0;
+}
+
+void save_stored_tile(TileStore* store, const TileKey* key, const int* iterations) {
+    if (store->stats.read_only) {
+        return;
+    }
+    
+    // the slot already holding key, else an empty one, else the least used
+    StoredEntry* bucket = find_store_bucket(store, key);
+    StoredEntry* entry = NULL;
+    for (int way = 0; way < BUCKET_WAYS && !entry; way++) {
+        if (bucket[way].checksum != 0 && entry_matches(&bucket[way], key)) {
+            entry = &bucket[way];
+        }
+    }
+    for (int way = 0; way < BUCKET_WAYS && !entry; way++) {
+        if (bucket[way].checksum == 0) {
+            entry = &bucket[way];
+            store->stats.used_slots++;
+        }
+    }
+    if (!entry) {
+        entry = &bucket[0];
+        for (int way = 0; way < BUCKET_WAYS; way++) {
+            if (bucket[way].uses < entry->uses) {
+                entry = &bucket[way];
+            }
+        }
+        // ages the others, so tiles that were popular once do not stay forever
+        for (int way = 0; way < BUCKET_WAYS; way++) {
+            bucket[way].uses /= 2;
+        }
+    }
+    
+    volatile StoredEntry* slot_entry = entry;
+    slot_entry->checksum = 0;
+    SDL_MemoryBarrierRelease();
+    entry->tx = key->tx;
+    entry->ty = key->ty;
+    entry->julia_real = key->julia_c.real;
+    entry->julia_imag = key->julia_c.imag;
+    entry->level = key->level;
+    entry->is_julia = key->is_julia;
+    entry->precision = (Sint32)key->precision;
+    entry->max_iterations = key->max_iterations;
+    entry->strategy = (Sint32)key->strategy;
+    entry->uses = 0;
+    size_t slot = (size_t)(entry - store->index);
+    memcpy(store->slots + slot * TILE_COUNTS, iterations, sizeof(Sint32) * TILE_COUNTS);
+    SDL_MemoryBarrierRelease();
+    slot_entry->checksum = checksum_tile(key, iterations);
+    store->stats.saves++;
+}
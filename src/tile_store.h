@@ -0,0 +1,43 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include "tile_cache.h"
+
+// Lattice tiles (see tile_cache.h) kept in a memory-mapped file across runs.
+// The file is a header, an index of fixed-size entries and one fixed-size
+// slot of escape counts per entry. A key hashes to a bucket of a few slots,
+// and when they are all taken the least used one is replaced. Every entry
+// carries a checksum of its key and counts that is written last and checked
+// on every load, so a slot torn by a crash, or being rewritten by another
+// process, reads as missing rather than wrong.
+//
+// One explorer at a time owns the file for writing; any others that open it
+// at the same time map it read-only and only load tiles.
+
+#define DEFAULT_TILE_STORE_MB 256
+#define TILE_STORE_FILE "tiles.bin"
+
+typedef struct {
+    Uint64 loads;           // tiles found in the file
+    Uint64 misses;          // tiles looked up and not found
+    Uint64 saves;
+    int slots;
+    int used_slots;
+    int read_only;
+} TileStoreStats;
+
+// Maps the store at path, creating it with room for about size_mb megabytes
+// of tiles if it does not exist or is not a store. An existing store keeps
+// the size it was created with. Returns NULL if the file cannot be opened,
+// read or mapped, the explorer then runs without it and leaves it as it is.
+TileStore* open_tile_store(const char* path, size_t size_mb);
+void close_tile_store(TileStore* store);
+TileStoreStats get_tile_store_stats(const TileStore* store);
+
+// Copies the escape counts stored for key into iterations (TILE_SIZE x
+// TILE_SIZE), returns 0 if there are none
+int load_stored_tile(TileStore* store, const TileKey* key, int* iterations);
+// Does nothing for a read-only store
+void save_stored_tile(TileStore* store, const TileKey* key, const int* iterations);
+
+#endif
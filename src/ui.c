@@ -1,157 +1,184 @@
-#include "ui.h"
-#include <stdio.h>
-#include <math.h>
-#include "mandelbrot.h"
-
-#define BUTTON_WIDTH 120
-#define BUTTON_HEIGHT 30
-#define PREVIEW_SIZE 200
-#define UI_PADDING 10
-#define UI_ALPHA 200
-#define FONT_SIZE 16
-
-void render_text(SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Rect* rect) {
-    SDL_Color color = {200, 200, 200, UI_ALPHA};
-    SDL_Surface* surface = TTF_RenderText_Blended(font, text, color);
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    
-    SDL_Rect text_rect = {
-        rect->x + (rect->w - surface->w) / 2,
-        rect->y + (rect->h - surface->h) / 2,
-        surface->w,
-        surface->h
-    };
-    
-    SDL_RenderCopy(renderer, texture, NULL, &text_rect);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
-}
-
-void render_julia_preview(UI* ui, SDL_Renderer* renderer, ViewPort view, Complex julia_c) {
-
-    ViewPort preview_view = {
-        .x_min = -1.5,
-        .x_max = 1.5,
-        .y_min = -1.5,
-        .y_max = 1.5,
-        .zoom = 1.0
-    };
-
-    SDL_SetRenderTarget(renderer, ui->preview_texture);
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-    
-    for (int x = 0; x < PREVIEW_SIZE; x++) {
-        for (int y = 0; y < PREVIEW_SIZE; y++) {
-            double real = preview_view.x_min + (x * (preview_view.x_max - preview_view.x_min)) / PREVIEW_SIZE;
-            double imag = preview_view.y_min + (y * (preview_view.y_max - preview_view.y_min)) / PREVIEW_SIZE;
-            Complex z = {real, imag};
-            
-            int iterations = julia(z, julia_c);
-            
-            if (iterations == MAX_ITERATIONS) {
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            } else {
-                double t = (double)iterations / MAX_ITERATIONS;
-                t = 0.5 + 0.5 * cos(log(t + 0.0001) * 3.0);
-                
-                int r = (int)(255 * t);
-                int g = (int)(255 * t);
-                int b = (int)(128 + (1.0 - t) * 127);
-                
-                SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-            }
-            SDL_RenderDrawPoint(renderer, x, y);
-        }
-    }
-    
-    SDL_SetRenderTarget(renderer, NULL);
-}
-
-void init_ui(UI* ui, SDL_Renderer* renderer) {
-    ui->reset_button = (SDL_Rect){UI_PADDING, UI_PADDING, BUTTON_WIDTH, BUTTON_HEIGHT};
-    
-    ui->julia_preview_button = (SDL_Rect){UI_PADDING, UI_PADDING * 2 + BUTTON_HEIGHT, 
-                                        BUTTON_WIDTH, BUTTON_HEIGHT};
-    
-    ui->julia_preview_window = (SDL_Rect){WINDOW_WIDTH - PREVIEW_SIZE - UI_PADDING,
-                                        UI_PADDING, PREVIEW_SIZE, PREVIEW_SIZE};
-    
-    ui->zoom_display = (SDL_Rect){UI_PADDING, UI_PADDING * 3 + BUTTON_HEIGHT * 2,
-                                 BUTTON_WIDTH, BUTTON_HEIGHT};
-    
-    ui->show_julia_preview = 0;
-    
-    ui->preview_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
-                                          SDL_TEXTUREACCESS_TARGET, PREVIEW_SIZE, PREVIEW_SIZE);
-    
-    TTF_Init();
-    ui->font = TTF_OpenFont("C:/Windows/Fonts/arial.ttf", FONT_SIZE);
-    if (!ui->font) {
-        printf("Font yüklenemedi: %s\n", TTF_GetError());
-    }
-}
-
-void render_ui(UI* ui, SDL_Renderer* renderer, ViewPort view, Complex julia_c, int is_julia) {
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-    
-    SDL_SetRenderDrawColor(renderer, 60, 60, 60, UI_ALPHA);
-    SDL_RenderFillRect(renderer, &ui->reset_button);
-    SDL_RenderFillRect(renderer, &ui->julia_preview_button);
-    SDL_RenderFillRect(renderer, &ui->zoom_display);
-    
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, UI_ALPHA);
-    SDL_RenderDrawRect(renderer, &ui->reset_button);
-    SDL_RenderDrawRect(renderer, &ui->julia_preview_button);
-    SDL_RenderDrawRect(renderer, &ui->zoom_display);
-    
-    if (ui->font) {
-        render_text(renderer, ui->font, "Reset", &ui->reset_button);
-        render_text(renderer, ui->font, "Julia Preview", &ui->julia_preview_button);
-        
-        char zoom_text[32];
-        snprintf(zoom_text, sizeof(zoom_text), "Zoom: %.2fx", view.zoom);
-        render_text(renderer, ui->font, zoom_text, &ui->zoom_display);
-    }
-    
-    if (ui->show_julia_preview && !is_julia) {
-        SDL_SetRenderDrawColor(renderer, 40, 40, 40, UI_ALPHA);
-        SDL_RenderFillRect(renderer, &ui->julia_preview_window);
-        SDL_RenderDrawRect(renderer, &ui->julia_preview_window);
-        
-        render_julia_preview(ui, renderer, view, julia_c);
-        SDL_RenderCopy(renderer, ui->preview_texture, NULL, &ui->julia_preview_window);
-    }
-}
-
-int handle_ui_event(UI* ui, SDL_Event event, ViewPort* view) {
-    if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
-        int x = event.button.x;
-        int y = event.button.y;
-        
-        if (SDL_PointInRect(&(SDL_Point){x, y}, &ui->reset_button)) {
-            view->x_min = -2.0;
-            view->x_max = 1.0;
-            view->y_min = -1.5;
-            view->y_max = 1.5;
-            view->zoom = 1.0;
-            return 1;
-        }
-        
-        if (SDL_PointInRect(&(SDL_Point){x, y}, &ui->julia_preview_button)) {
-            ui->show_julia_preview = !ui->show_julia_preview;
-            return 1;
-        }
-    }
-    return 0;
-}
-
-void cleanup_ui(UI* ui) {
-    if (ui->preview_texture) {
-        SDL_DestroyTexture(ui->preview_texture);
-    }
-    if (ui->font) {
-        TTF_CloseFont(ui->font);
-    }
-    TTF_Quit();
-} 
+#include "ui.h"
+#include <stdio.h>
+#include "mandelbrot.h"
+
+#define BUTTON_WIDTH 120
+#define BUTTON_HEIGHT 30
+#define PREVIEW_SIZE 200
+#define UI_PADDING 10
+#define UI_ALPHA 200
+#define FONT_SIZE 16
+#define HUD_WIDTH 210
+#define HUD_LINE_HEIGHT 20
+#define HUD_LINES (STAGE_COUNT + 2)
+
+static const char* stage_names[STAGE_COUNT] = {"Compute", "Upload", "UI", "Present"};
+
+// Queues text vertically centered in rect, either centered or starting at its left edge
+static void draw_text(UI* ui, SDL_Renderer* renderer, const char* text, const SDL_Rect* rect, int centered) {
+    SDL_Color color = {200, 200, 200, UI_ALPHA};
+    int x = centered ? rect->x + (rect->w - measure_text(&ui->text, text)) / 2 : rect->x;
+    int y = rect->y + (rect->h - ui->text.line_height) / 2;
+    queue_text(&ui->text, renderer, text, x, y, color);
+}
+
+void init_ui(UI* ui, SDL_Renderer* renderer) {
+    ui->reset_button = (SDL_Rect){UI_PADDING, UI_PADDING, BUTTON_WIDTH, BUTTON_HEIGHT};
+    
+    ui->julia_preview_button = (SDL_Rect){UI_PADDING, UI_PADDING * 2 + BUTTON_HEIGHT, 
+                                        BUTTON_WIDTH, BUTTON_HEIGHT};
+    
+    ui->julia_preview_window = (SDL_Rect){WINDOW_WIDTH - PREVIEW_SIZE - UI_PADDING,
+                                        UI_PADDING, PREVIEW_SIZE, PREVIEW_SIZE};
+    
+    ui->zoom_display = (SDL_Rect){UI_PADDING, UI_PADDING * 3 + BUTTON_HEIGHT * 2,
+                                 BUTTON_WIDTH, BUTTON_HEIGHT};
+    
+    int hud_height = HUD_LINES * HUD_LINE_HEIGHT + UI_PADDING;
+    ui->hud = (SDL_Rect){UI_PADDING, WINDOW_HEIGHT - UI_PADDING - hud_height, HUD_WIDTH, hud_height};
+    
+    ui->show_julia_preview = 0;
+    ui->show_hud = 0;
+    ui->timings = (FrameTimings){0};
+    
+    init_julia_preview(&ui->preview, renderer, PREVIEW_SIZE);
+    
+    init_glyph_atlas(&ui->text, renderer, FONT_SIZE);
+}
+
+static double ticks_to_ms(Uint64 ticks) {
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Averages of the frames in ui->timings, throughput per second of compute time
+static void render_hud(UI* ui, SDL_Renderer* renderer) {
+    const FrameTimings* timings = &ui->timings;
+    const FrameSample* total = &timings->total;
+    int frames = SDL_max(timings->count, 1);
+    char lines[HUD_LINES][48];
+    
+    Uint64 busy_ticks = 0;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        busy_ticks += total->stage_ticks[stage];
+    }
+    double interval_ms = ticks_to_ms(total->interval_ticks);
+    snprintf(lines[0], sizeof(lines[0]), "Frame %.2f ms, %.0f FPS", ticks_to_ms(busy_ticks) / frames,
+             interval_ms > 0.0 ? 1000.0 * timings->count / interval_ms : 0.0);
+    
+    double compute_ms = ticks_to_ms(total->stage_ticks[STAGE_COMPUTE]);
+    double per_second = compute_ms > 0.0 ? 1000.0 / compute_ms : 0.0;
+    snprintf(lines[1], sizeof(lines[1]), "%.1f Mpix/s, %.2f Giter/s",
+             total->points * per_second / 1e6, total->iterations * per_second / 1e9);
+    
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        snprintf(lines[2 + stage], sizeof(lines[0]), "%-8s %7.2f ms", stage_names[stage],
+                 ticks_to_ms(total->stage_ticks[stage]) / frames);
+    }
+    
+    SDL_SetRenderDrawColor(renderer, 60, 60, 60, UI_ALPHA);
+    SDL_RenderFillRect(renderer, &ui->hud);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, UI_ALPHA);
+    SDL_RenderDrawRect(renderer, &ui->hud);
+    for (int i = 0; i < HUD_LINES; i++) {
+        SDL_Rect line = {ui->hud.x + UI_PADDING, ui->hud.y + UI_PADDING / 2 + i * HUD_LINE_HEIGHT,
+                         ui->hud.w - 2 * UI_PADDING, HUD_LINE_HEIGHT};
+        draw_text(ui, renderer, lines[i], &line, 0);
+    }
+}
+
+void render_ui(UI* ui, SDL_Renderer* renderer, ViewPort view, Complex julia_c, int is_julia, int max_iterations) {
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    
+    SDL_SetRenderDrawColor(renderer, 60, 60, 60, UI_ALPHA);
+    SDL_RenderFillRect(renderer, &ui->reset_button);
+    SDL_RenderFillRect(renderer, &ui->julia_preview_button);
+    SDL_RenderFillRect(renderer, &ui->zoom_display);
+    
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, UI_ALPHA);
+    SDL_RenderDrawRect(renderer, &ui->reset_button);
+    SDL_RenderDrawRect(renderer, &ui->julia_preview_button);
+    SDL_RenderDrawRect(renderer, &ui->zoom_display);
+    
+    draw_text(ui, renderer, "Reset", &ui->reset_button, 1);
+    draw_text(ui, renderer, "Julia Preview", &ui->julia_preview_button, 1);
+    
+    char zoom_text[32];
+    snprintf(zoom_text, sizeof(zoom_text), "Zoom: %.3gx", view.zoom);
+    draw_text(ui, renderer, zoom_text, &ui->zoom_display, 1);
+    
+    if (ui->show_julia_preview && !is_julia && ui->preview.thread) {
+        SDL_SetRenderDrawColor(renderer, 40, 40, 40, UI_ALPHA);
+        SDL_RenderFillRect(renderer, &ui->julia_preview_window);
+        SDL_RenderDrawRect(renderer, &ui->julia_preview_window);
+        
+        // the last finished preview stays up until the one for julia_c is done
+        request_julia_preview(&ui->preview, julia_c, max_iterations);
+        if (update_julia_preview(&ui->preview)) {
+            SDL_RenderCopy(renderer, ui->preview.frame.texture, NULL, &ui->julia_preview_window);
+        }
+    }
+    
+    if (ui->show_hud) {
+        render_hud(ui, renderer);
+    }
+    
+    // nothing drawn above overlaps text, so all of it goes out as one batch
+    flush_text(&ui->text, renderer);
+}
+
+int handle_ui_event(UI* ui, SDL_Event event, ViewPort* view) {
+    if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+        int x = event.button.x;
+        int y = event.button.y;
+        
+        if (SDL_PointInRect(&(SDL_Point){x, y}, &ui->reset_button)) {
+            *view = make_view(-0.5, 0.0, HOME_WIDTH, HOME_WIDTH);
+            return 1;
+        }
+        
+        if (SDL_PointInRect(&(SDL_Point){x, y}, &ui->julia_preview_button)) {
+            ui->show_julia_preview = !ui->show_julia_preview;
+            return 1;
+        }
+    }
+    if (event.type == ui->preview.ready_event && ui->preview.thread) {
+        return 1;
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h) {
+        ui->show_hud = !ui->show_hud;
+        return 1;
+    }
+    return 0;
+}
+
+void record_frame_timing(UI* ui, const FrameSample* sample) {
+    FrameTimings* timings = &ui->timings;
+    FrameSample* total = &timings->total;
+    FrameSample* slot = &timings->samples[timings->next];
+    
+    // the oldest frame leaves the sums once the window is full
+    if (timings->count == HUD_SAMPLES) {
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            total->stage_ticks[stage] -= slot->stage_ticks[stage];
+        }
+        total->interval_ticks -= slot->interval_ticks;
+        total->points -= slot->points;
+        total->iterations -= slot->iterations;
+    } else {
+        timings->count++;
+    }
+    
+    *slot = *sample;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        total->stage_ticks[stage] += sample->stage_ticks[stage];
+    }
+    total->interval_ticks += sample->interval_ticks;
+    total->points += sample->points;
+    total->iterations += sample->iterations;
+    timings->next = (timings->next + 1) % HUD_SAMPLES;
+}
+
+void cleanup_ui(UI* ui) {
+    destroy_julia_preview(&ui->preview);
+    destroy_glyph_atlas(&ui->text);
+} 
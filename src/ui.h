@@ -1,25 +1,58 @@
-#ifndef UI_H
-#define UI_H
-
-#include <SDL.h>
-#include <SDL_ttf.h>
-#include "mouse_handler.h"
-
-#define MAX_ITERATIONS 150
-
-typedef struct {
-    SDL_Rect reset_button;
-    SDL_Rect julia_preview_button;
-    SDL_Rect julia_preview_window;
-    SDL_Rect zoom_display;
-    int show_julia_preview;
-    SDL_Texture* preview_texture;
-    TTF_Font* font;
-} UI;
-
-void init_ui(UI* ui, SDL_Renderer* renderer);
-void render_ui(UI* ui, SDL_Renderer* renderer, ViewPort view, Complex julia_c, int is_julia);
-int handle_ui_event(UI* ui, SDL_Event event, ViewPort* view);
-void cleanup_ui(UI* ui);
-
+#ifndef UI_H
+#define UI_H
+
+#include <SDL.h>
+#include "glyph_atlas.h"
+#include "julia_preview.h"
+#include "mandelbrot.h"
+
+// Where the main loop's time goes, as shown by the timing HUD
+typedef enum {
+    STAGE_COMPUTE,      // iterating and coloring pixels
+    STAGE_UPLOAD,       // copying the frame into its texture
+    STAGE_UI,           // clearing, copying the frame and render_ui()
+    STAGE_PRESENT,      // SDL_RenderPresent()
+    STAGE_COUNT
+} FrameStage;
+
+// frames the HUD averages over
+#define HUD_SAMPLES 60
+
+// Performance counter ticks and work of one presented frame
+typedef struct {
+    Uint64 stage_ticks[STAGE_COUNT];
+    Uint64 interval_ticks;  // since the previous frame was presented
+    Uint64 points;          // pixels iterated
+    Uint64 iterations;      // escape counts of those pixels, summed
+} FrameSample;
+
+// The last HUD_SAMPLES frames and their sum, so averages cost nothing to update
+typedef struct {
+    FrameSample samples[HUD_SAMPLES];
+    FrameSample total;
+    int count;
+    int next;
+} FrameTimings;
+
+typedef struct {
+    SDL_Rect reset_button;
+    SDL_Rect julia_preview_button;
+    SDL_Rect julia_preview_window;
+    SDL_Rect zoom_display;
+    SDL_Rect hud;
+    int show_julia_preview;
+    int show_hud;
+    FrameTimings timings;
+    JuliaPreview preview;
+    GlyphAtlas text;
+} UI;
+
+void init_ui(UI* ui, SDL_Renderer* renderer);
+// max_iterations is the limit the main view is rendered with, the preview follows it
+void render_ui(UI* ui, SDL_Renderer* renderer, ViewPort view, Complex julia_c, int is_julia, int max_iterations);
+int handle_ui_event(UI* ui, SDL_Event event, ViewPort* view);
+// Adds a presented frame to the rolling averages the HUD shows
+void record_frame_timing(UI* ui, const FrameSample* sample);
+void cleanup_ui(UI* ui);
+
 #endif 
\ No newline at end of file